@@ -9,9 +9,11 @@
 #include <QThread>
 #include <QDebug>
 #include <QFile>
+#include <QList>
 #include <QDir>
 #include <QTextStream>
 #include <QString>
+#include <QStringList>
 
 #include "../../src/asynctextwriter.h"
 
@@ -51,6 +53,9 @@ private slots:
     void writeToReadOnlyFile();
     void writeToReadOnlyDirectory();
     void writeAlreadyInProgress();
+    void writeCoalescing();
+    void writeWithBackups();
+    void writeWithBackupsToSymLink();
 };
 
 void AsyncTextWriterTest::runWriteTest(const QString &fileName,
@@ -404,7 +409,8 @@ void AsyncTextWriterTest::writeToReadOnlyDirectory()
  *
  * EXPECTED RESULTS:
  *      - First call to write() returns true.
- *      - Second call to write() returns true.
+ *      - Second call to write() returns true without waiting for the
+ *        first write to finish.
  *      - File is created and written to successfully.
  *      - File contents match input string of final write() call.
  */
@@ -439,11 +445,13 @@ void AsyncTextWriterTest::writeAlreadyInProgress()
     firstCallStatus = writer.write("Hello, world!\n");
     secondCallStatus = writer.write(expectedContents);
 
-    // Give the thread time to complete the writes.
-    QThread::sleep(1);
+    // Verify the second write is waiting for the first one.
+    QVERIFY(writer.writeInProgress());
 
-    // Force signal/event processing.
-    qApp->processEvents();
+    // Give the threads time to complete the writes, processing the
+    // signal from the first write so that the second write starts.
+    //
+    QTRY_VERIFY_WITH_TIMEOUT(!writer.writeInProgress(), 5000);
 
     // Verify first call's return value.
     QCOMPARE(firstCallStatus, true);
@@ -477,5 +485,242 @@ void AsyncTextWriterTest::writeAlreadyInProgress()
     }
 }
 
+/**
+ * OBJECTIVE:
+ *      Call write() several times while a write is in progress.
+ *
+ * INPUTS:
+ *      Three calls to write() in a row with different text strings.
+ *
+ * EXPECTED RESULTS:
+ *      - Each call to write() is assigned the next revision number.
+ *      - The second revision is superseded by the third without being
+ *        written.
+ *      - The first and third revisions are written.
+ *      - File contents match input string of final write() call.
+ */
+void AsyncTextWriterTest::writeCoalescing()
+{
+    QString fileName = "coalescing.txt";
+    QString expectedContents = "third\n";
+    QList<int> writtenRevisions;
+    QList<int> supersededRevisions;
+    QList<int> failedRevisions;
+
+    AsyncTextWriter writer(fileName);
+
+    this->connect(
+        &writer,
+        &AsyncTextWriter::revisionWritten,
+        [&writtenRevisions](int revision) {
+            writtenRevisions.append(revision);
+        }
+    );
+
+    this->connect(
+        &writer,
+        &AsyncTextWriter::revisionSuperseded,
+        [&supersededRevisions](int revision) {
+            supersededRevisions.append(revision);
+        }
+    );
+
+    this->connect(
+        &writer,
+        &AsyncTextWriter::revisionFailed,
+        [&failedRevisions](int revision, const QString &err) {
+            failedRevisions.append(revision);
+            qWarning() << QString("Error writing to file: ") + err;
+        }
+    );
+
+    QCOMPARE(writer.lastRevision(), 0);
+
+    QVERIFY(writer.write("first\n"));
+    QCOMPARE(writer.lastRevision(), 1);
+    QVERIFY(writer.write("second\n"));
+    QCOMPARE(writer.lastRevision(), 2);
+    QVERIFY(writer.write(expectedContents));
+    QCOMPARE(writer.lastRevision(), 3);
+
+    // Verify the second revision was dropped as soon as the third one
+    // replaced it.
+    //
+    QCOMPARE(supersededRevisions, QList<int>({2}));
+
+    writer.waitForFinished();
+
+    QCOMPARE(writer.writeInProgress(), false);
+    QCOMPARE(writtenRevisions, QList<int>({1, 3}));
+    QVERIFY(failedRevisions.isEmpty());
+
+    QFile file(writer.fileName());
+    bool fileReadable = file.open(QIODevice::ReadOnly | QIODevice::Text);
+
+    QVERIFY(fileReadable);
+
+    if (fileReadable) {
+        QTextStream stream(&file);
+        QString actualContents = stream.readAll();
+        file.close();
+
+        // Verify file contents read from disk.
+        QCOMPARE(actualContents, expectedContents);
+
+        // Cleanup.
+        file.remove();
+    }
+}
+
+/**
+ * OBJECTIVE:
+ *      Write to a file several times with backups enabled.
+ *
+ * INPUTS:
+ *      - Backup count of 2.
+ *      - Three calls to write() with different text strings, each made
+ *        after the previous write finished.
+ *
+ * EXPECTED RESULTS:
+ *      - File contents match input string of final write() call.
+ *      - The .backup file contains the text of the second write.
+ *      - The .backup.2 file contains the text of the first write.
+ *      - No backupError() signal is received.
+ */
+void AsyncTextWriterTest::writeWithBackups()
+{
+    QString fileName = "backups.txt";
+    QStringList contents = { "first\n", "second\n", "third\n" };
+    bool noErrors = true;
+
+    AsyncTextWriter writer(fileName);
+    writer.setBackupCount(2);
+    QCOMPARE(writer.backupCount(), 2);
+
+    this->connect(
+        &writer,
+        &AsyncTextWriter::backupError,
+        [&noErrors](const QString &err) {
+            noErrors = false;
+            qWarning() << QString("Error backing up file: ") + err;
+        }
+    );
+
+    for (const QString &text : contents) {
+        QVERIFY(writer.write(text));
+        writer.waitForFinished();
+    }
+
+    QVERIFY(noErrors);
+
+    QString backupFileName = writer.fileName() + ".backup";
+    QStringList filePaths =
+        { writer.fileName(), backupFileName, backupFileName + ".2" };
+
+    for (int i = 0; i < filePaths.size(); i++) {
+        QFile file(filePaths[i]);
+        bool fileReadable = file.open(QIODevice::ReadOnly | QIODevice::Text);
+
+        QVERIFY(fileReadable);
+
+        if (fileReadable) {
+            QTextStream stream(&file);
+            QString actualContents = stream.readAll();
+            file.close();
+
+            QCOMPARE(actualContents, contents[contents.size() - 1 - i]);
+        }
+    }
+
+    // Cleanup.
+    for (const QString &filePath : filePaths) {
+        QFile::remove(filePath);
+    }
+}
+
+/**
+ * OBJECTIVE:
+ *      Write to a symbolic link to a file with backups enabled.
+ *
+ * INPUTS:
+ *      - Symbolic link to a file containing some text.
+ *      - Backup count of 1.
+ *      - One call to write() with different text.
+ *
+ * EXPECTED RESULTS:
+ *      - The link's target file contents match the written text.
+ *      - The .backup file next to the link contains the target file's
+ *        original text, rather than following the target's new
+ *        contents.
+ *      - No backupError() signal is received.
+ */
+void AsyncTextWriterTest::writeWithBackupsToSymLink()
+{
+#ifdef Q_OS_WIN
+    QSKIP("QFile::link() creates shortcuts rather than symbolic links on Windows.");
+#endif
+
+    QString targetFileName = "symlinktarget.txt";
+    QString fileName = "symlink.txt";
+    QString originalContents = "original\n";
+    QString newContents = "new\n";
+    bool noErrors = true;
+
+    QFile targetFile(targetFileName);
+    QVERIFY(targetFile.open(QIODevice::WriteOnly | QIODevice::Text));
+    targetFile.write(originalContents.toUtf8());
+    targetFile.close();
+
+    QFile::remove(fileName);
+
+    if (!QFile::link(targetFileName, fileName)) {
+        QFile::remove(targetFileName);
+        QSKIP("Symbolic links are not supported.");
+    }
+
+    AsyncTextWriter writer(fileName);
+    writer.setBackupCount(1);
+
+    this->connect(
+        &writer,
+        &AsyncTextWriter::backupError,
+        [&noErrors](const QString &err) {
+            noErrors = false;
+            qWarning() << QString("Error backing up file: ") + err;
+        }
+    );
+
+    QVERIFY(writer.write(newContents));
+    writer.waitForFinished();
+
+    QVERIFY(noErrors);
+
+    QString backupFileName = fileName + ".backup";
+    QStringList filePaths = { targetFileName, backupFileName };
+    QStringList expectedContents = { newContents, originalContents };
+
+    for (int i = 0; i < filePaths.size(); i++) {
+        QFile file(filePaths[i]);
+        bool fileReadable = file.open(QIODevice::ReadOnly | QIODevice::Text);
+
+        QVERIFY(fileReadable);
+
+        if (fileReadable) {
+            QTextStream stream(&file);
+            QString actualContents = stream.readAll();
+            file.close();
+
+            QCOMPARE(actualContents, expectedContents[i]);
+        }
+    }
+
+    // Cleanup.
+    QFile::remove(fileName);
+
+    for (const QString &filePath : filePaths) {
+        QFile::remove(filePath);
+    }
+}
+
 QTEST_MAIN(AsyncTextWriterTest)
 #include "asynctextwritertest.moc"
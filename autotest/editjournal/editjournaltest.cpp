@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "../../src/editjournal.h"
+
+using namespace ghostwriter;
+
+/**
+ * Unit test for the EditJournal class.
+ */
+class EditJournalTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+
+    QString filePath(const QString &fileName) const;
+
+private slots:
+    void initTestCase();
+    void replay();
+    void replayWithoutEdits();
+    void truncatedRecord();
+    void hashMismatch();
+    void commit();
+    void remove();
+};
+
+QString EditJournalTest::filePath(const QString &fileName) const
+{
+    return dir.filePath(fileName);
+}
+
+void EditJournalTest::initTestCase()
+{
+    QVERIFY(dir.isValid());
+}
+
+/**
+ * OBJECTIVE:
+ *      Recover text from a journal of edits (nominal case).
+ *
+ * INPUTS:
+ *      - Journal opened for a file with base text.
+ *      - An insertion of non-ASCII text, a replacement, and a removal.
+ *      - Journal closed without removing its file.
+ *
+ * EXPECTED RESULTS:
+ *      - filePath() returns the path the journal was opened with.
+ *      - The journal file exists after close().
+ *      - recover() returns true, with the base text with the edits
+ *        applied in order.
+ */
+void EditJournalTest::replay()
+{
+    QString path = filePath("replay.md");
+    QString baseText = "# Title\n\nSome text.\n";
+
+    EditJournal journal;
+    QVERIFY(journal.open(path, baseText));
+    QCOMPARE(journal.filePath(), path);
+
+    journal.record(0, 0, QString::fromUtf8("\xc3\xa9 "));
+    journal.record(12, 4, "words");
+    journal.record(4, 5, QString());
+    journal.close(false);
+
+    QVERIFY(QFile::exists(EditJournal::journalFilePath(path)));
+
+    QString expectedText = baseText;
+    expectedText.replace(0, 0, QString::fromUtf8("\xc3\xa9 "));
+    expectedText.replace(12, 4, "words");
+    expectedText.replace(4, 5, QString());
+
+    QString recoveredText;
+    QVERIFY(EditJournal::recover(path, baseText, recoveredText));
+    QCOMPARE(recoveredText, expectedText);
+}
+
+/**
+ * OBJECTIVE:
+ *      Recover from a journal whose edits leave the text unchanged
+ *      (nominal case).
+ *
+ * INPUTS:
+ *      - Journal opened for a file with base text.
+ *      - An edit that replaces text with the same text.
+ *
+ * EXPECTED RESULTS:
+ *      - recover() returns false, and the recovered text is null.
+ */
+void EditJournalTest::replayWithoutEdits()
+{
+    QString path = filePath("unchanged.md");
+    QString baseText = "Nothing to see here.\n";
+
+    EditJournal journal;
+    QVERIFY(journal.open(path, baseText));
+    journal.record(0, 7, "Nothing");
+    journal.close(false);
+
+    // The edit put back the text that was there, so there is nothing to
+    // recover.
+    //
+    QString recoveredText;
+    QVERIFY(!EditJournal::recover(path, baseText, recoveredText));
+    QVERIFY(recoveredText.isNull());
+}
+
+/**
+ * OBJECTIVE:
+ *      Recover from a journal whose last record was cut short
+ *      (robustness case).
+ *
+ * INPUTS:
+ *      - Journal with two insertion records.
+ *      - The last two bytes of the journal file removed.
+ *
+ * EXPECTED RESULTS:
+ *      - recover() returns true, with only the first insertion applied
+ *        to the base text.
+ */
+void EditJournalTest::truncatedRecord()
+{
+    QString path = filePath("truncated.md");
+    QString baseText = "abc\n";
+
+    EditJournal journal;
+    QVERIFY(journal.open(path, baseText));
+    journal.record(3, 0, "def");
+    journal.close(false);
+
+    qint64 sizeWithOneRecord = QFileInfo(EditJournal::journalFilePath(path)).size();
+
+    QVERIFY(journal.open(path, baseText));
+    journal.record(3, 0, "def");
+    journal.record(6, 0, "ghi");
+    QVERIFY(journal.size() > sizeWithOneRecord);
+    journal.close(false);
+
+    // Cut the last record short, as if the application crashed while it
+    // was being written.
+    //
+    QFile journalFile(EditJournal::journalFilePath(path));
+    QVERIFY(journalFile.resize(journalFile.size() - 2));
+    QVERIFY(journalFile.size() > sizeWithOneRecord);
+
+    QString recoveredText;
+    QVERIFY(EditJournal::recover(path, baseText, recoveredText));
+    QCOMPARE(recoveredText, QString("abcdef\n"));
+}
+
+/**
+ * OBJECTIVE:
+ *      Recover with base text that differs from the text the journal
+ *      was opened with (robustness case).
+ *
+ * INPUTS:
+ *      - Journal opened with one base text, with one edit recorded.
+ *      - A different base text passed to recover().
+ *
+ * EXPECTED RESULTS:
+ *      - recover() returns false, and the recovered text is null.
+ */
+void EditJournalTest::hashMismatch()
+{
+    QString path = filePath("mismatch.md");
+
+    EditJournal journal;
+    QVERIFY(journal.open(path, "original text\n"));
+    journal.record(0, 0, "new ");
+    journal.close(false);
+
+    // The file was changed by something else since the journal started.
+    QString recoveredText;
+    QVERIFY(!EditJournal::recover(path, "different text\n", recoveredText));
+    QVERIFY(recoveredText.isNull());
+}
+
+/**
+ * OBJECTIVE:
+ *      Compact the journal once a checkpoint's text has been saved
+ *      (nominal case).
+ *
+ * INPUTS:
+ *      - Edits followed by a checkpoint of the saved text.
+ *      - An edit made while the checkpoint is being saved.
+ *      - A second checkpoint that is discarded.
+ *      - commit() of the first checkpoint, then one more edit.
+ *
+ * EXPECTED RESULTS:
+ *      - The journal is smaller after commit().
+ *      - recover() with the original base text returns false.
+ *      - recover() with the checkpoint's text returns true, with the
+ *        edits made after the checkpoint applied.
+ */
+void EditJournalTest::commit()
+{
+    QString path = filePath("commit.md");
+    QString baseText = "one\n";
+
+    EditJournal journal;
+    QVERIFY(journal.open(path, baseText));
+
+    journal.record(4, 0, "two\n");
+    journal.record(8, 0, "three\n");
+    QString savedText = "one\ntwo\nthree\n";
+    journal.checkpoint(1, savedText);
+
+    // Edits made while the checkpoint's text is being written.
+    journal.record(14, 0, "four\n");
+
+    // A checkpoint whose text was never written.
+    journal.checkpoint(2, savedText + "four\n");
+    journal.discard(2);
+
+    qint64 sizeBeforeCommit = journal.size();
+    journal.commit(1);
+    QVERIFY(journal.size() < sizeBeforeCommit);
+
+    journal.record(19, 0, "five\n");
+    journal.close(false);
+
+    // The journal now starts from the checkpoint's text, and only holds
+    // the edits made since.
+    //
+    QString recoveredText;
+    QVERIFY(!EditJournal::recover(path, baseText, recoveredText));
+    QVERIFY(EditJournal::recover(path, savedText, recoveredText));
+    QCOMPARE(recoveredText, QString("one\ntwo\nthree\nfour\nfive\n"));
+}
+
+/**
+ * OBJECTIVE:
+ *      Close the journal and remove its file (nominal case).
+ *
+ * INPUTS:
+ *      - Journal with one edit recorded.
+ *      - close() called with true.
+ *
+ * EXPECTED RESULTS:
+ *      - isOpen() returns false.
+ *      - The journal file no longer exists.
+ *      - recover() returns false.
+ */
+void EditJournalTest::remove()
+{
+    QString path = filePath("remove.md");
+
+    EditJournal journal;
+    QVERIFY(journal.open(path, "text\n"));
+    journal.record(0, 0, "more ");
+    journal.close(true);
+
+    QVERIFY(!journal.isOpen());
+    QVERIFY(!QFile::exists(EditJournal::journalFilePath(path)));
+
+    QString recoveredText;
+    QVERIFY(!EditJournal::recover(path, "text\n", recoveredText));
+}
+
+QTEST_GUILESS_MAIN(EditJournalTest)
+#include "editjournaltest.moc"
@@ -0,0 +1,266 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QTest>
+#include <QtGlobal>
+
+#include "../../src/latencyhistogram.h"
+
+using namespace ghostwriter;
+
+/**
+ * Unit test for the LatencyHistogram class.  Checks the bucket boundaries
+ * through the upper bound reported for a single recorded value, and the
+ * percentiles of known distributions.
+ */
+class LatencyHistogramTest: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void bucketUpperBound_data();
+    void bucketUpperBound();
+    void empty();
+    void uniformDistribution();
+    void bimodalDistribution();
+    void merge();
+    void clear();
+};
+
+void LatencyHistogramTest::bucketUpperBound_data()
+{
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<qint64>("upperBound");
+
+    const qint64 maxValue = (Q_INT64_C(1) << 36) - 1;
+
+    // Values below 32 each have a bucket of their own.
+    QTest::newRow("negative") << Q_INT64_C(-5) << Q_INT64_C(0);
+    QTest::newRow("0") << Q_INT64_C(0) << Q_INT64_C(0);
+    QTest::newRow("1") << Q_INT64_C(1) << Q_INT64_C(1);
+    QTest::newRow("31") << Q_INT64_C(31) << Q_INT64_C(31);
+
+    // From 32 to 63, buckets are two wide.
+    QTest::newRow("32") << Q_INT64_C(32) << Q_INT64_C(33);
+    QTest::newRow("33") << Q_INT64_C(33) << Q_INT64_C(33);
+    QTest::newRow("46") << Q_INT64_C(46) << Q_INT64_C(47);
+    QTest::newRow("47") << Q_INT64_C(47) << Q_INT64_C(47);
+    QTest::newRow("48") << Q_INT64_C(48) << Q_INT64_C(49);
+    QTest::newRow("63") << Q_INT64_C(63) << Q_INT64_C(63);
+
+    // From 64 to 127, buckets are four wide.
+    QTest::newRow("64") << Q_INT64_C(64) << Q_INT64_C(67);
+    QTest::newRow("127") << Q_INT64_C(127) << Q_INT64_C(127);
+    QTest::newRow("1000") << Q_INT64_C(1000) << Q_INT64_C(1023);
+
+    // The last power of two, and values past it, which all land in the
+    // last bucket.
+    //
+    QTest::newRow("2^35") << (Q_INT64_C(1) << 35)
+        << ((Q_INT64_C(17) << 31) - 1);
+    QTest::newRow("2^36 - 1") << maxValue << maxValue;
+    QTest::newRow("2^36") << (Q_INT64_C(1) << 36) << maxValue;
+    QTest::newRow("2^50") << (Q_INT64_C(1) << 50) << maxValue;
+}
+
+/**
+ * OBJECTIVE:
+ *      Record a single value, and read back the upper bound of its bucket
+ *      (nominal and robustness cases).
+ *
+ * INPUTS:
+ *      1. Negative value, and values below 32.
+ *      2. Values on either side of the bucket boundaries from 32 to 127.
+ *      3. The smallest value with the maximum exponent, 2^35.
+ *      4. Values at and past the largest value that can be recorded.
+ *
+ * EXPECTED RESULTS:
+ *      1. Values below 32 are their own upper bound, and negative values
+ *         are recorded as 0.
+ *      2. The upper bound is the last value of the bucket's range.
+ *      3. The upper bound is the end of 2^35's bucket, which is 2^31 wide.
+ *      4. The upper bound is 2^36 - 1.
+ *      - count() returns 1, and maximum(), percentile(0.0) and
+ *        percentile(100.0) all return the upper bound.
+ */
+void LatencyHistogramTest::bucketUpperBound()
+{
+    QFETCH(qint64, value);
+    QFETCH(qint64, upperBound);
+
+    LatencyHistogram histogram;
+    histogram.record(value);
+
+    QCOMPARE(histogram.count(), Q_INT64_C(1));
+    QCOMPARE(histogram.maximum(), upperBound);
+    QCOMPARE(histogram.percentile(0.0), upperBound);
+    QCOMPARE(histogram.percentile(100.0), upperBound);
+}
+
+/**
+ * OBJECTIVE:
+ *      Query a histogram with nothing recorded (robustness case).
+ *
+ * INPUTS:
+ *      - Default constructed histogram.
+ *
+ * EXPECTED RESULTS:
+ *      - count(), percentile() and maximum() all return 0.
+ */
+void LatencyHistogramTest::empty()
+{
+    LatencyHistogram histogram;
+
+    QCOMPARE(histogram.count(), Q_INT64_C(0));
+    QCOMPARE(histogram.percentile(50.0), Q_INT64_C(0));
+    QCOMPARE(histogram.maximum(), Q_INT64_C(0));
+}
+
+/**
+ * OBJECTIVE:
+ *      Compute percentiles of a uniform distribution (nominal case).
+ *
+ * INPUTS:
+ *      - Each value from 1 to 10,000 recorded once.
+ *      - Percentiles from 0.01 to 100.
+ *
+ * EXPECTED RESULTS:
+ *      - count() returns 10,000.
+ *      - Each percentile is no less than the exact value, and no more than
+ *        1/16 above it.
+ *      - The 0.01 percentile is 1, the median is 5119, and maximum()
+ *        returns 10,239.
+ */
+void LatencyHistogramTest::uniformDistribution()
+{
+    LatencyHistogram histogram;
+
+    for (qint64 value = 1; value <= 10000; value++) {
+        histogram.record(value);
+    }
+
+    QCOMPARE(histogram.count(), Q_INT64_C(10000));
+
+    // Each percentile is the upper bound of the bucket holding the exact
+    // value, which is no more than 1/16 above it.
+    //
+    const qreal percents[] = { 0.01, 1.0, 10.0, 25.0, 50.0, 90.0, 95.0, 99.0, 99.9, 100.0 };
+
+    for (qreal percent : percents) {
+        qint64 exact = qint64(qRound(percent * 100.0));
+        qint64 actual = histogram.percentile(percent);
+
+        QVERIFY2
+        (
+            (actual >= exact) && (actual <= (exact + (exact / 16))),
+            qPrintable(QString("p%1 is %2, expected about %3")
+                .arg(percent)
+                .arg(actual)
+                .arg(exact))
+        );
+    }
+
+    QCOMPARE(histogram.percentile(0.01), Q_INT64_C(1));
+    QCOMPARE(histogram.percentile(50.0), Q_INT64_C(5119));
+    QCOMPARE(histogram.maximum(), Q_INT64_C(10239));
+}
+
+/**
+ * OBJECTIVE:
+ *      Compute percentiles of a bimodal distribution (nominal case).
+ *
+ * INPUTS:
+ *      - 90 values of 10, and 10 values of 1000.
+ *
+ * EXPECTED RESULTS:
+ *      - The 50th and 90th percentiles are 10.
+ *      - Percentiles past the 90th, and maximum(), are 1023, the upper
+ *        bound of 1000's bucket.
+ */
+void LatencyHistogramTest::bimodalDistribution()
+{
+    LatencyHistogram histogram;
+
+    for (int i = 0; i < 90; i++) {
+        histogram.record(10);
+    }
+
+    for (int i = 0; i < 10; i++) {
+        histogram.record(1000);
+    }
+
+    QCOMPARE(histogram.percentile(50.0), Q_INT64_C(10));
+    QCOMPARE(histogram.percentile(90.0), Q_INT64_C(10));
+    QCOMPARE(histogram.percentile(90.1), Q_INT64_C(1023));
+    QCOMPARE(histogram.percentile(99.0), Q_INT64_C(1023));
+    QCOMPARE(histogram.maximum(), Q_INT64_C(1023));
+}
+
+/**
+ * OBJECTIVE:
+ *      Merge one histogram into another (nominal case).
+ *
+ * INPUTS:
+ *      - Histogram with 75 values of 5.
+ *      - Histogram with 25 values of 20, merged into the first.
+ *
+ * EXPECTED RESULTS:
+ *      - The merged histogram counts 100 values, with a 75th percentile
+ *        of 5 and a 76th percentile and maximum of 20.
+ *      - The histogram merged from is unchanged.
+ */
+void LatencyHistogramTest::merge()
+{
+    LatencyHistogram fast;
+    LatencyHistogram slow;
+
+    for (int i = 0; i < 75; i++) {
+        fast.record(5);
+    }
+
+    for (int i = 0; i < 25; i++) {
+        slow.record(20);
+    }
+
+    fast.merge(slow);
+
+    QCOMPARE(fast.count(), Q_INT64_C(100));
+    QCOMPARE(fast.percentile(75.0), Q_INT64_C(5));
+    QCOMPARE(fast.percentile(76.0), Q_INT64_C(20));
+    QCOMPARE(fast.maximum(), Q_INT64_C(20));
+
+    // The merged histogram is left as it was.
+    QCOMPARE(slow.count(), Q_INT64_C(25));
+    QCOMPARE(slow.percentile(1.0), Q_INT64_C(20));
+}
+
+/**
+ * OBJECTIVE:
+ *      Clear a histogram, and record into it again (nominal case).
+ *
+ * INPUTS:
+ *      - Histogram with one value recorded, then cleared.
+ *      - A new value recorded after clear().
+ *
+ * EXPECTED RESULTS:
+ *      - count() and maximum() return 0 after clear().
+ *      - The median is the new value, unaffected by the cleared one.
+ */
+void LatencyHistogramTest::clear()
+{
+    LatencyHistogram histogram;
+    histogram.record(100);
+    histogram.clear();
+
+    QCOMPARE(histogram.count(), Q_INT64_C(0));
+    QCOMPARE(histogram.maximum(), Q_INT64_C(0));
+
+    histogram.record(7);
+    QCOMPARE(histogram.percentile(50.0), Q_INT64_C(7));
+}
+
+QTEST_APPLESS_MAIN(LatencyHistogramTest)
+#include "latencyhistogramtest.moc"
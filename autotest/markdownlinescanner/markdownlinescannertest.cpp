@@ -0,0 +1,294 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QTest>
+
+#include "../../src/markdownlinescanner.h"
+
+using namespace ghostwriter;
+
+/**
+ * Unit test for the MarkdownLineScanner class.  Checks that it agrees with
+ * the regular expressions that the MarkdownHighlighter used before it, and
+ * benchmarks how many lines per second the highlighter can probe with each.
+ */
+class MarkdownLineScannerTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    QRegularExpression referenceDefinitionRegex;
+    QRegularExpression inlineHtmlCommentRegex;
+    QStringList benchmarkLines;
+
+    /*
+    * Prints the number of lines probed per second over the given time.
+    */
+    void printThroughput(const QString &name, qint64 lineCount, qint64 nsecs);
+
+private slots:
+    void initTestCase();
+    void isBlank_data();
+    void isBlank();
+    void referenceDefinitionLength_data();
+    void referenceDefinitionLength();
+    void isInlineHtmlComment_data();
+    void isInlineHtmlComment();
+    void benchmarkScanner();
+    void benchmarkRegex();
+};
+
+void MarkdownLineScannerTest::initTestCase()
+{
+    referenceDefinitionRegex.setPattern("^\\s*\\[(.+?)[^\\\\]\\]:");
+    inlineHtmlCommentRegex.setPattern("^\\s*<\\!--.*-->\\s*$");
+
+    // A mix of the lines found in a typical document, most of which are
+    // plain prose that neither pattern matches.
+    //
+    const QStringList sampleLines = {
+        "It was a dark and stormy night; the rain fell in torrents, except "
+            "at occasional intervals, when it was checked by a violent gust "
+            "of wind.",
+        "",
+        "    ",
+        "[ghostwriter]: https://ghostwriter.kde.org \"ghostwriter\"",
+        "<!-- TODO: rewrite this chapter -->",
+        "Nothing here is [a link] or <!-- a comment",
+        "- A list item with **strong** text",
+        "    indented code block line with [brackets]: inside"
+    };
+
+    for (int i = 0; i < 10000; i++) {
+        benchmarkLines.append(sampleLines[i % sampleLines.size()]);
+    }
+}
+
+void MarkdownLineScannerTest::isBlank_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<bool>("expected");
+
+    QTest::newRow("empty") << "" << true;
+    QTest::newRow("spaces and tabs") << " \t  " << true;
+    QTest::newRow("non-breaking space") << QString(QChar(0x00A0)) << true;
+    QTest::newRow("text") << "  text  " << false;
+}
+
+/**
+ * OBJECTIVE:
+ *      Call isBlank() (nominal and robustness cases).
+ *
+ * INPUTS:
+ *      1. Empty line.
+ *      2. Line of spaces and tabs.
+ *      3. Line with a non-breaking space.
+ *      4. Line with text surrounded by spaces.
+ *
+ * EXPECTED RESULTS:
+ *      1-3. isBlank() returns true.
+ *      4. isBlank() returns false.
+ *      - isBlank() agrees with QString::trimmed().isEmpty() for each line.
+ */
+void MarkdownLineScannerTest::isBlank()
+{
+    QFETCH(QString, line);
+    QFETCH(bool, expected);
+
+    QCOMPARE(MarkdownLineScanner::isBlank(line), expected);
+    QCOMPARE(MarkdownLineScanner::isBlank(line), line.trimmed().isEmpty());
+}
+
+void MarkdownLineScannerTest::referenceDefinitionLength_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("nominal") << "[label]: http://example.com" << 8;
+    QTest::newRow("leading whitespace") << "   [label]: url" << 11;
+    QTest::newRow("two character label") << "[ab]: url" << 5;
+    QTest::newRow("one character label") << "[a]: url" << 0;
+    QTest::newRow("empty label") << "[]: url" << 0;
+    QTest::newRow("escaped bracket") << "[a\\]: b]: url" << 9;
+    QTest::newRow("only escaped bracket") << "[ab\\]: url" << 0;
+    QTest::newRow("colon in label") << "[a:b]: url" << 6;
+    QTest::newRow("no colon") << "[label] url" << 0;
+    QTest::newRow("text before bracket") << "text [label]: url" << 0;
+    QTest::newRow("ends after bracket") << "[label]" << 0;
+    QTest::newRow("empty") << "" << 0;
+}
+
+/**
+ * OBJECTIVE:
+ *      Call referenceDefinitionLength() (nominal and robustness cases).
+ *
+ * INPUTS:
+ *      - Reference definitions with and without leading whitespace, and
+ *        with escaped brackets and colons in their labels.
+ *      - Lines that only resemble reference definitions, such as labels
+ *        that are too short, labels without a colon, and text before
+ *        the opening bracket.
+ *
+ * EXPECTED RESULTS:
+ *      - referenceDefinitionLength() returns the length of the label up
+ *        to and including its colon, or 0 if the line is not a reference
+ *        definition.
+ *      - The result agrees with the highlighter's former regular
+ *        expression.
+ */
+void MarkdownLineScannerTest::referenceDefinitionLength()
+{
+    QFETCH(QString, line);
+    QFETCH(int, expected);
+
+    QRegularExpressionMatch match = referenceDefinitionRegex.match(line);
+
+    QCOMPARE(MarkdownLineScanner::referenceDefinitionLength(line), expected);
+    QCOMPARE(expected > 0, match.hasMatch());
+
+    if (match.hasMatch()) {
+        QCOMPARE(expected, match.capturedEnd());
+    }
+}
+
+void MarkdownLineScannerTest::isInlineHtmlComment_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<bool>("expected");
+
+    QTest::newRow("nominal") << "<!-- comment -->" << true;
+    QTest::newRow("surrounding whitespace") << "  <!-- comment -->\t" << true;
+    QTest::newRow("empty comment") << "<!---->" << true;
+    QTest::newRow("overlapping markers") << "<!-->" << false;
+    QTest::newRow("unterminated") << "<!-- comment" << false;
+    QTest::newRow("text after comment") << "<!-- comment --> text" << false;
+    QTest::newRow("text before comment") << "text <!-- comment -->" << false;
+    QTest::newRow("empty") << "" << false;
+}
+
+/**
+ * OBJECTIVE:
+ *      Call isInlineHtmlComment() (nominal and robustness cases).
+ *
+ * INPUTS:
+ *      - Lines that hold only an HTML comment, with and without
+ *        surrounding whitespace, and an empty comment.
+ *      - Lines with overlapping comment markers, an unterminated comment,
+ *        or text before or after the comment, and an empty line.
+ *
+ * EXPECTED RESULTS:
+ *      - isInlineHtmlComment() returns true for the first group of lines
+ *        and false for the second.
+ *      - The result agrees with the highlighter's former regular
+ *        expression.
+ */
+void MarkdownLineScannerTest::isInlineHtmlComment()
+{
+    QFETCH(QString, line);
+    QFETCH(bool, expected);
+
+    QCOMPARE(MarkdownLineScanner::isInlineHtmlComment(line), expected);
+    QCOMPARE(inlineHtmlCommentRegex.match(line).hasMatch(), expected);
+}
+
+/**
+ * OBJECTIVE:
+ *      Measure how many lines per second MarkdownLineScanner can probe
+ *      (benchmark).
+ *
+ * INPUTS:
+ *      - 10,000 lines of typical prose, blank lines, reference
+ *        definitions and HTML comments.
+ *
+ * EXPECTED RESULTS:
+ *      - At least one line matches.
+ *      - The throughput is printed for comparison with benchmarkRegex().
+ */
+void MarkdownLineScannerTest::benchmarkScanner()
+{
+    int matches = 0;
+    qint64 lineCount = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    // Probe each line in the same order as the highlighter does for the
+    // lines that the Markdown parser reports no node for.
+    //
+    QBENCHMARK {
+        lineCount += benchmarkLines.size();
+
+        for (const QString &line : qAsConst(benchmarkLines)) {
+            if (MarkdownLineScanner::isBlank(line)) {
+                continue;
+            } else if (MarkdownLineScanner::referenceDefinitionLength(line) > 0) {
+                matches++;
+            } else if (MarkdownLineScanner::isInlineHtmlComment(line)) {
+                matches++;
+            }
+        }
+    }
+
+    QVERIFY(matches > 0);
+    printThroughput("scanner", lineCount, timer.nsecsElapsed());
+}
+
+/**
+ * OBJECTIVE:
+ *      Measure how many lines per second the highlighter's former regular
+ *      expressions can probe (benchmark).
+ *
+ * INPUTS:
+ *      - The same lines as benchmarkScanner().
+ *
+ * EXPECTED RESULTS:
+ *      - At least one line matches.
+ *      - The throughput is printed for comparison with benchmarkScanner().
+ */
+void MarkdownLineScannerTest::benchmarkRegex()
+{
+    int matches = 0;
+    qint64 lineCount = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK {
+        lineCount += benchmarkLines.size();
+
+        for (const QString &line : qAsConst(benchmarkLines)) {
+            if (line.trimmed().isEmpty()) {
+                continue;
+            } else if (referenceDefinitionRegex.match(line).hasMatch()) {
+                matches++;
+            } else if (inlineHtmlCommentRegex.match(line).hasMatch()) {
+                matches++;
+            }
+        }
+    }
+
+    QVERIFY(matches > 0);
+    printThroughput("regex", lineCount, timer.nsecsElapsed());
+}
+
+void MarkdownLineScannerTest::printThroughput
+(
+    const QString &name,
+    qint64 lineCount,
+    qint64 nsecs
+)
+{
+    if (nsecs > 0) {
+        qInfo("%s: %.0f lines per second",
+            qPrintable(name),
+            lineCount * 1.0e9 / nsecs);
+    }
+}
+
+QTEST_MAIN(MarkdownLineScannerTest)
+#include "markdownlinescannertest.moc"
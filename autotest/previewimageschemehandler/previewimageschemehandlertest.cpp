@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QString>
+#include <QTest>
+
+#include "../../src/previewimageschemehandler.h"
+
+using namespace ghostwriter;
+
+/**
+ * Unit test for the PreviewImageSchemeHandler class's rewriting of image
+ * sources in the live preview's HTML.
+ */
+class PreviewImageSchemeHandlerTest: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rewriteImageSources_data();
+    void rewriteImageSources();
+    void rewriteWithoutWidth();
+};
+
+void PreviewImageSchemeHandlerTest::rewriteImageSources_data()
+{
+    QTest::addColumn<QString>("source");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("absolute path")
+        << "/home/me/pics/a.jpg"
+        << "ghostwriter-image:///home/me/pics/a.jpg?width=800";
+    QTest::newRow("absolute path with space")
+        << "/home/me/My%20Pics/a.jpg"
+        << "ghostwriter-image:///home/me/My%20Pics/a.jpg?width=800";
+    QTest::newRow("absolute path with non-ASCII characters")
+        << "/home/me/pics/Stra%C3%9Fe.jpg"
+        << "ghostwriter-image:///home/me/pics/Stra%C3%9Fe.jpg?width=800";
+    QTest::newRow("file URL with space")
+        << "file:///home/me/My%20Pics/a.png"
+        << "ghostwriter-image:///home/me/My%20Pics/a.png?width=800";
+    QTest::newRow("relative path with space")
+        << "My%20Pics/a.png"
+        << "ghostwriter-image:///home/me/docs/My%20Pics/a.png?width=800";
+    QTest::newRow("relative path with non-ASCII characters")
+        << "pics/Stra%C3%9Fe.png"
+        << "ghostwriter-image:///home/me/docs/pics/Stra%C3%9Fe.png?width=800";
+    QTest::newRow("remote URL")
+        << "https://example.com/a.jpg"
+        << "https://example.com/a.jpg";
+    QTest::newRow("unsupported format")
+        << "/home/me/pics/a.svg"
+        << "/home/me/pics/a.svg";
+}
+
+/**
+ * OBJECTIVE:
+ *      Call rewriteImageSources() with an img tag (nominal and robustness
+ *      cases).
+ *
+ * INPUTS:
+ *      1. Absolute path to a raster image.
+ *      2. Absolute path containing a percent-encoded space.
+ *      3. Absolute path containing percent-encoded non-ASCII characters.
+ *      4. File URL containing a percent-encoded space.
+ *      5. Relative path containing a percent-encoded space.
+ *      6. Relative path containing percent-encoded non-ASCII characters.
+ *      7. Remote URL.
+ *      8. Absolute path to an image in an unsupported format.
+ *
+ * EXPECTED RESULTS:
+ *      1-6. The source is replaced with a URL for the handler's scheme
+ *           whose path is the image's decoded absolute path, encoded only
+ *           once, with relative paths resolved against the base directory.
+ *      7-8. The source is left unchanged.
+ */
+void PreviewImageSchemeHandlerTest::rewriteImageSources()
+{
+    QFETCH(QString, source);
+    QFETCH(QString, expected);
+
+    QString html =
+        QString("<p><img src=\"%1\" alt=\"A picture\" /></p>").arg(source);
+    QString expectedHtml =
+        QString("<p><img src=\"%1\" alt=\"A picture\" /></p>").arg(expected);
+
+    QCOMPARE(
+        PreviewImageSchemeHandler::rewriteImageSources(html, "/home/me/docs", 800),
+        expectedHtml
+    );
+}
+
+/**
+ * OBJECTIVE:
+ *      Call rewriteImageSources() without a target width (robustness case).
+ *
+ * INPUTS:
+ *      - HTML with an img tag referencing an absolute image path.
+ *      - Width of zero.
+ *
+ * EXPECTED RESULTS:
+ *      - The HTML is returned unchanged.
+ */
+void PreviewImageSchemeHandlerTest::rewriteWithoutWidth()
+{
+    QString html("<p><img src=\"/home/me/pics/a.jpg\" /></p>");
+
+    QCOMPARE(
+        PreviewImageSchemeHandler::rewriteImageSources(html, "/home/me/docs", 0),
+        html
+    );
+}
+
+QTEST_APPLESS_MAIN(PreviewImageSchemeHandlerTest)
+#include "previewimageschemehandlertest.moc"
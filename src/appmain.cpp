@@ -11,6 +11,9 @@
 #include <QDateTime>
 #include <QLibraryInfo>
 #include <QLocale>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 #include <QTranslator>
 #include <QWindow>
 
@@ -18,6 +21,141 @@
 
 #include "mainwindow.h"
 #include "appsettings.h"
+#include "batchexporter.h"
+#include "exportcache.h"
+#include "previewimageschemehandler.h"
+#include "tracer.h"
+
+/*
+* Adds the command line options for batch export mode to the parser.
+*/
+static void addExportOptions(QCommandLineParser &clParser)
+{
+    clParser.addOption(QCommandLineOption("export",
+        QCoreApplication::translate("main",
+            "Exports the files to the given format (name or file extension) "
+            "without opening a window."),
+        "format"));
+    clParser.addOption(QCommandLineOption("processor",
+        QCoreApplication::translate("main",
+            "Markdown processor to export with, such as cmark-gfm or Pandoc."),
+        "name"));
+    clParser.addOption(QCommandLineOption(QStringList() << "o" << "output-dir",
+        QCoreApplication::translate("main",
+            "Directory in which to write exported files."),
+        "dir",
+        "."));
+    clParser.addOption(QCommandLineOption(QStringList() << "j" << "jobs",
+        QCoreApplication::translate("main",
+            "Maximum number of files to export in parallel."),
+        "count",
+        QString::number(QThread::idealThreadCount())));
+    clParser.addOption(QCommandLineOption("smart-typography",
+        QCoreApplication::translate("main",
+            "Exports using smart typography.")));
+    clParser.addOption(QCommandLineOption("cache",
+        QCoreApplication::translate("main",
+            "Reuses the result of a previous export of the same file "
+            "with the same options instead of converting it again.")));
+    clParser.addOption(QCommandLineOption("cache-size",
+        QCoreApplication::translate("main",
+            "Maximum size of the export cache in megabytes."),
+        "megabytes",
+        QString::number(ghostwriter::ExportCache::DEFAULT_MAX_SIZE_MB)));
+}
+
+/*
+* Runs the batch export mode without creating a GUI, so that it can be
+* used on machines without a display.  Returns the process exit code:
+* 0 if all files were exported, 1 if any file failed, and 2 for usage
+* errors.
+*/
+static int exportFiles(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ghostwriter");
+    QCoreApplication::setOrganizationDomain("kde.org");
+    QCoreApplication::setApplicationVersion(APPVERSION);
+
+    QCommandLineParser clParser;
+    clParser.setApplicationDescription(QCoreApplication::translate("main",
+        "Exports Markdown files in parallel."));
+    clParser.addHelpOption();
+    clParser.addVersionOption();
+    clParser.addPositionalArgument("files",
+        QCoreApplication::translate("main", "Files to export."),
+        "files...");
+    addExportOptions(clParser);
+    clParser.process(app);
+
+    QTextStream errStream(stderr);
+    QStringList filePaths = clParser.positionalArguments();
+
+    if (filePaths.isEmpty()) {
+        errStream << QCoreApplication::translate("main", "No files to export.")
+                  << Qt::endl;
+        return 2;
+    }
+
+    ghostwriter::BatchExporter exporter(clParser.value("output-dir"));
+    QString err;
+
+    if (!exporter.setExporter(clParser.value("processor"),
+            clParser.value("export"), err)) {
+        errStream << err << Qt::endl;
+        return 2;
+    }
+
+    bool ok = false;
+    int jobs = clParser.value("jobs").toInt(&ok);
+
+    if (!ok || (jobs < 1)) {
+        errStream << QCoreApplication::translate("main",
+            "Invalid number of jobs: %1").arg(clParser.value("jobs"))
+                  << Qt::endl;
+        return 2;
+    }
+
+    exporter.setMaxThreadCount(jobs);
+    exporter.setSmartTypographyEnabled(clParser.isSet("smart-typography"));
+
+    ghostwriter::ExportCache *cache = ghostwriter::ExportCache::instance();
+
+    if (clParser.isSet("cache")) {
+        int cacheSize = clParser.value("cache-size").toInt(&ok);
+
+        if (!ok || (cacheSize < 1)) {
+            errStream << QCoreApplication::translate("main",
+                "Invalid cache size: %1").arg(clParser.value("cache-size"))
+                      << Qt::endl;
+            return 2;
+        }
+
+        cache->setMaxSize(cacheSize);
+        cache->setEnabled(true);
+    }
+
+    int failureCount = exporter.exportFiles(filePaths);
+
+    if (cache->isEnabled()) {
+        errStream << QCoreApplication::translate("main",
+            "Export cache: %1 hits, %2 misses.")
+                .arg(cache->hitCount())
+                .arg(cache->missCount())
+                  << Qt::endl;
+    }
+
+    if (failureCount > 0) {
+        errStream << QCoreApplication::translate("main",
+            "%1 of %2 files failed to export.")
+                .arg(failureCount)
+                .arg(filePaths.size())
+                  << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -26,11 +164,14 @@ int main(int argc, char *argv[])
     // Unfortunately, we must preparse the arguments for the --disable-gpu
     // option rather than using QCommandLineParser since we must set the
     // software rendering attribute before creating the QApplication.
+    // Likewise, batch export must not create a QApplication at all.
     //
     for (int i = 0; i < argc; i++) {
         if (0 == strcmp(argv[i], "--disable-gpu")) {
             disableGPU = true;
-            break;
+        } else if ((0 == strcmp(argv[i], "--export"))
+                || (0 == strncmp(argv[i], "--export=", 9))) {
+            return exportFiles(argc, argv);
         }
     }
 
@@ -65,6 +206,11 @@ int main(int argc, char *argv[])
     // current theme is not supported yet.
     QCoreApplication::setAttribute(Qt::AA_DontShowIconsInMenus, true);
 
+    // Custom URL schemes for the live preview must be registered before
+    // the application instance is created.
+    //
+    ghostwriter::PreviewImageSchemeHandler::registerScheme();
+
     QApplication app(argc, argv);
 
 #if QT_VERSION >= 0x050700 && defined(Q_OS_LINUX)
@@ -155,9 +301,48 @@ int main(int argc, char *argv[])
         QCoreApplication::translate("main", "Disables GPU acceleration."));
 
     clParser.addOption(renderingOption);
+
+    QCommandLineOption traceOption("trace",
+        QCoreApplication::translate("main",
+            "Records where time is spent while editing, and writes it to "
+            "<file> on exit in the Chrome trace event format.  The %1 "
+            "environment variable can be set to the file instead.")
+            .arg(ghostwriter::Tracer::ENVIRONMENT_VARIABLE),
+        QCoreApplication::translate("main", "file"));
+
+    clParser.addOption(traceOption);
+
+    QCommandLineOption latencyHudOption("latency-hud",
+        QCoreApplication::translate("main",
+            "Shows typing, parsing, highlighting and preview latencies in "
+            "the status bar.  The %1 environment variable can be set to 1 "
+            "instead.")
+            .arg(ghostwriter::LatencyMonitor::ENVIRONMENT_VARIABLE));
+
+    clParser.addOption(latencyHudOption);
+
+    // Batch export options were already handled by exportFiles(). Add
+    // them here only so they are displayed in the help output.
+    //
+    addExportOptions(clParser);
     clParser.process(app);
     aboutData.processCommandLine(&clParser);
 
+    QString traceFilePath = clParser.value(traceOption);
+
+    if (traceFilePath.isEmpty()) {
+        traceFilePath = qEnvironmentVariable(ghostwriter::Tracer::ENVIRONMENT_VARIABLE);
+    }
+
+    if (!traceFilePath.isEmpty()) {
+        ghostwriter::Tracer::start(traceFilePath);
+    }
+
+    if (clParser.isSet(latencyHudOption)
+            || !qEnvironmentVariableIsEmpty(ghostwriter::LatencyMonitor::ENVIRONMENT_VARIABLE)) {
+        ghostwriter::Tracer::startMonitoring();
+    }
+
     QStringList posArgs = clParser.positionalArguments();
 
     app.setWindowIcon(QIcon::fromTheme(QStringLiteral("ghostwriter")));
@@ -172,5 +357,19 @@ int main(int argc, char *argv[])
     ghostwriter::MainWindow window(filePath);
 
     window.show();
-    return app.exec();
+
+    int result = app.exec();
+
+    // Let the preview's worker threads finish recording trace events
+    // before they are written.
+    //
+    QThreadPool::globalInstance()->waitForDone();
+
+    QString traceErr;
+
+    if (!ghostwriter::Tracer::writeTrace(traceErr)) {
+        QTextStream(stderr) << traceErr << Qt::endl;
+    }
+
+    return result;
 }
@@ -20,6 +20,7 @@
 #include <QTranslator>
 
 #include "appsettings.h"
+#include "exportcache.h"
 #include "exporterfactory.h"
 
 #define GW_FAVORITE_STATISTIC_KEY "Session/favoriteStatistic"
@@ -27,6 +28,7 @@
 #define GW_REMEMBER_FILE_HISTORY_KEY "Session/rememberFileHistory"
 #define GW_AUTOSAVE_KEY "Save/autoSave"
 #define GW_BACKUP_FILE_KEY "Save/backupFile"
+#define GW_BACKUP_FILE_COUNT_KEY "Save/backupFileCount"
 #define GW_EDITOR_FONT_KEY "Style/editorFont"
 #define GW_LARGE_HEADINGS_KEY "Style/largeHeadings"
 #define GW_AUTO_MATCH_KEY "Typing/autoMatchEnabled"
@@ -48,6 +50,9 @@
 #define GW_SIDEBAR_OPEN_KEY "Window/sidebarOpen"
 #define GW_HTML_PREVIEW_OPEN_KEY "Preview/htmlPreviewOpen"
 #define GW_LAST_USED_EXPORTER_KEY "Preview/lastUsedExporter"
+#define GW_HTML_PREVIEW_UNLOAD_DELAY_KEY "Preview/unloadDelay"
+#define GW_EXPORT_CACHE_ENABLED_KEY "Export/cacheEnabled"
+#define GW_EXPORT_CACHE_MAX_SIZE_KEY "Export/cacheMaxSize"
 #define GW_PREVIEW_TEXT_FONT_KEY "Preview/textFont"
 #define GW_PREVIEW_CODE_FONT_KEY "Preview/codeFont"
 
@@ -74,6 +79,7 @@ public:
     bool autoMatchEnabled;
     bool autoSaveEnabled;
     bool backupFileEnabled;
+    int backupFileCount;
     QString draftLocation;
     bool bulletPointCyclingEnabled;
     bool displayTimeInFullScreenEnabled;
@@ -82,6 +88,9 @@ public:
     bool fileHistoryEnabled;
     bool hideMenuBarInFullScreenEnabled;
     bool htmlPreviewVisible;
+    int htmlPreviewUnloadDelay;
+    bool exportCacheEnabled;
+    int exportCacheMaxSize;
     bool sidebarVisible;
     bool insertSpacesForTabsEnabled;
     bool largeHeadingSizesEnabled;
@@ -89,6 +98,11 @@ public:
     bool useUnderlineForEmphasis;
     EditorWidth editorWidth;
     Exporter *currentHtmlExporter;
+
+    // Name of the HTML exporter last chosen by the user, which may not
+    // be available until external processors have been detected.
+    //
+    QString preferredHtmlExporterName;
     FocusMode focusMode;
     int tabWidth;
     InterfaceStyle interfaceStyle;
@@ -130,6 +144,7 @@ void AppSettings::store()
     appSettings.setValue(GW_AUTO_MATCH_KEY, QVariant(d->autoMatchEnabled));
     appSettings.setValue(GW_AUTOSAVE_KEY, QVariant(d->autoSaveEnabled));
     appSettings.setValue(GW_BACKUP_FILE_KEY, QVariant(d->backupFileEnabled));
+    appSettings.setValue(GW_BACKUP_FILE_COUNT_KEY, QVariant(d->backupFileCount));
     appSettings.setValue(GW_BULLET_CYCLING_KEY, QVariant(d->bulletPointCyclingEnabled));
     appSettings.setValue(GW_DISPLAY_TIME_IN_FULL_SCREEN_KEY, QVariant(d->displayTimeInFullScreenEnabled));
     appSettings.setValue(GW_EDITOR_WIDTH_KEY, QVariant(d->editorWidth));
@@ -143,7 +158,7 @@ void AppSettings::store()
     appSettings.setValue(GW_LARGE_HEADINGS_KEY, QVariant(d->largeHeadingSizesEnabled));
     appSettings.setValue(GW_SIDEBAR_OPEN_KEY, QVariant(d->sidebarVisible));
     appSettings.setValue(GW_HTML_PREVIEW_OPEN_KEY, QVariant(d->htmlPreviewVisible));
-    appSettings.setValue(GW_LAST_USED_EXPORTER_KEY, QVariant(d->currentHtmlExporter->name()));
+    appSettings.setValue(GW_LAST_USED_EXPORTER_KEY, QVariant(d->preferredHtmlExporterName));
     appSettings.setValue(GW_LIVE_SPELL_CHECK_KEY, QVariant(d->liveSpellCheckEnabled));
     appSettings.setValue(GW_LOCALE_KEY, QVariant(d->locale));
     appSettings.setValue(GW_RESTORE_SESSION_KEY, QVariant(d->restoreSessionEnabled));
@@ -151,6 +166,9 @@ void AppSettings::store()
     appSettings.setValue(GW_REMEMBER_FILE_HISTORY_KEY, QVariant(d->fileHistoryEnabled));
     appSettings.setValue(GW_SPACES_FOR_TABS_KEY, QVariant(d->insertSpacesForTabsEnabled));
     appSettings.setValue(GW_TAB_WIDTH_KEY, QVariant(d->tabWidth));
+    appSettings.setValue(GW_HTML_PREVIEW_UNLOAD_DELAY_KEY, QVariant(d->htmlPreviewUnloadDelay));
+    appSettings.setValue(GW_EXPORT_CACHE_ENABLED_KEY, QVariant(d->exportCacheEnabled));
+    appSettings.setValue(GW_EXPORT_CACHE_MAX_SIZE_KEY, QVariant(d->exportCacheMaxSize));
     appSettings.setValue(GW_THEME_KEY, QVariant(d->themeName));
     appSettings.setValue(GW_DARK_MODE_KEY, QVariant(d->darkModeEnabled));
     appSettings.setValue(GW_UNDERLINE_ITALICS_KEY, QVariant(d->useUnderlineForEmphasis));
@@ -195,6 +213,23 @@ void AppSettings::setBackupFileEnabled(bool enabled)
     emit backupFileChanged(enabled);
 }
 
+int AppSettings::backupFileCount() const
+{
+    Q_D(const AppSettings);
+
+    return d->backupFileCount;
+}
+
+void AppSettings::setBackupFileCount(int count)
+{
+    Q_D(AppSettings);
+
+    if ((count > 0) && (count <= MAX_BACKUP_FILE_COUNT)) {
+        d->backupFileCount = count;
+        emit backupFileCountChanged(count);
+    }
+}
+
 QString AppSettings::draftLocation() const
 {
     Q_D(const AppSettings);
@@ -608,6 +643,55 @@ void AppSettings::setHtmlPreviewVisible(bool visible)
     d->htmlPreviewVisible = visible;
 }
 
+int AppSettings::htmlPreviewUnloadDelay() const
+{
+    Q_D(const AppSettings);
+    
+    return d->htmlPreviewUnloadDelay;
+}
+
+void AppSettings::setHtmlPreviewUnloadDelay(int seconds)
+{
+    Q_D(AppSettings);
+    
+    if ((seconds >= 0) && (seconds <= MAX_HTML_PREVIEW_UNLOAD_DELAY)) {
+        d->htmlPreviewUnloadDelay = seconds;
+        emit htmlPreviewUnloadDelayChanged(seconds);
+    }
+}
+
+bool AppSettings::exportCacheEnabled() const
+{
+    Q_D(const AppSettings);
+    
+    return d->exportCacheEnabled;
+}
+
+void AppSettings::setExportCacheEnabled(bool enabled)
+{
+    Q_D(AppSettings);
+    
+    d->exportCacheEnabled = enabled;
+    emit exportCacheEnabledChanged(enabled);
+}
+
+int AppSettings::exportCacheMaxSize() const
+{
+    Q_D(const AppSettings);
+    
+    return d->exportCacheMaxSize;
+}
+
+void AppSettings::setExportCacheMaxSize(int megabytes)
+{
+    Q_D(AppSettings);
+    
+    if ((megabytes > 0) && (megabytes <= MAX_EXPORT_CACHE_SIZE)) {
+        d->exportCacheMaxSize = megabytes;
+        emit exportCacheMaxSizeChanged(megabytes);
+    }
+}
+
 bool AppSettings::sidebarVisible() const
 {
     Q_D(const AppSettings);
@@ -634,6 +718,7 @@ void AppSettings::setCurrentHtmlExporter(Exporter *exporter)
     Q_D(AppSettings);
     
     d->currentHtmlExporter = exporter;
+    d->preferredHtmlExporterName = exporter->name();
     emit currentHtmlExporterChanged(exporter);
 }
 
@@ -723,6 +808,11 @@ AppSettings::AppSettings()
 
     d->autoSaveEnabled = appSettings.value(GW_AUTOSAVE_KEY, QVariant(true)).toBool();
     d->backupFileEnabled = appSettings.value(GW_BACKUP_FILE_KEY, QVariant(true)).toBool();
+    d->backupFileCount = appSettings.value(GW_BACKUP_FILE_COUNT_KEY, QVariant(1)).toInt();
+
+    if ((d->backupFileCount <= 0) || (d->backupFileCount > MAX_BACKUP_FILE_COUNT)) {
+        d->backupFileCount = 1;
+    }
     d->editorFont.fromString(appSettings.value(GW_EDITOR_FONT_KEY, QVariant(monospaceFont)).toString());
     d->previewTextFont.fromString(appSettings.value(GW_PREVIEW_TEXT_FONT_KEY, QVariant(variableFont)).toString());
     d->previewCodeFont.fromString(appSettings.value(GW_PREVIEW_CODE_FONT_KEY, QVariant(monospaceFont)).toString());
@@ -732,6 +822,19 @@ AppSettings::AppSettings()
         d->tabWidth = DEFAULT_TAB_WIDTH;
     }
 
+    d->htmlPreviewUnloadDelay = appSettings.value(GW_HTML_PREVIEW_UNLOAD_DELAY_KEY, QVariant(DEFAULT_HTML_PREVIEW_UNLOAD_DELAY)).toInt();
+
+    if ((d->htmlPreviewUnloadDelay < 0) || (d->htmlPreviewUnloadDelay > MAX_HTML_PREVIEW_UNLOAD_DELAY)) {
+        d->htmlPreviewUnloadDelay = DEFAULT_HTML_PREVIEW_UNLOAD_DELAY;
+    }
+
+    d->exportCacheEnabled = appSettings.value(GW_EXPORT_CACHE_ENABLED_KEY, QVariant(false)).toBool();
+    d->exportCacheMaxSize = appSettings.value(GW_EXPORT_CACHE_MAX_SIZE_KEY, QVariant(ExportCache::DEFAULT_MAX_SIZE_MB)).toInt();
+
+    if ((d->exportCacheMaxSize <= 0) || (d->exportCacheMaxSize > MAX_EXPORT_CACHE_SIZE)) {
+        d->exportCacheMaxSize = ExportCache::DEFAULT_MAX_SIZE_MB;
+    }
+
     d->insertSpacesForTabsEnabled = appSettings.value(GW_SPACES_FOR_TABS_KEY, QVariant(false)).toBool();
     d->useUnderlineForEmphasis = appSettings.value(GW_UNDERLINE_ITALICS_KEY, QVariant(false)).toBool();
     d->largeHeadingSizesEnabled = appSettings.value(GW_LARGE_HEADINGS_KEY, QVariant(true)).toBool();
@@ -775,7 +878,32 @@ AppSettings::AppSettings()
 
     if (nullptr == d->currentHtmlExporter) {
         d->currentHtmlExporter = ExporterFactory::instance()->htmlExporters().first();
+
+        // Keep the last used exporter's name in case it is an external
+        // processor that is still being detected.
+        //
+        if (ExporterFactory::instance()->isDetectionFinished()) {
+            exporterName = d->currentHtmlExporter->name();
+        }
     }
+
+    d->preferredHtmlExporterName = exporterName;
+
+    this->connect(
+        ExporterFactory::instance(),
+        &ExporterFactory::exportersChanged,
+        this,
+        [this, d]() {
+            Exporter *exporter =
+                ExporterFactory::instance()->exporterByName(d->preferredHtmlExporterName);
+
+            if (nullptr == exporter) {
+                d->preferredHtmlExporterName = d->currentHtmlExporter->name();
+            } else if (exporter != d->currentHtmlExporter) {
+                setCurrentHtmlExporter(exporter);
+            }
+        }
+    );
 }
 
 QString AppSettingsPrivate::firstAvailableFont(const QStringList& fontList) const
@@ -33,6 +33,10 @@ public:
     static const int MIN_TAB_WIDTH = 1;
     static const int MAX_TAB_WIDTH = 8;
     static const int DEFAULT_TAB_WIDTH = 4;
+    static const int MAX_HTML_PREVIEW_UNLOAD_DELAY = 3600;
+    static const int DEFAULT_HTML_PREVIEW_UNLOAD_DELAY = 60;
+    static const int MAX_EXPORT_CACHE_SIZE = 10240;
+    static const int MAX_BACKUP_FILE_COUNT = 10;
 
     static AppSettings *instance();
     ~AppSettings();
@@ -50,6 +54,10 @@ public:
     Q_SLOT void setBackupFileEnabled(bool enabled);
     Q_SIGNAL void backupFileChanged(bool enabled);
 
+    int backupFileCount() const;
+    Q_SLOT void setBackupFileCount(int count);
+    Q_SIGNAL void backupFileCountChanged(int count);
+
     QFont editorFont() const;
     void setEditorFont(const QFont &font);
 
@@ -139,6 +147,18 @@ public:
     bool htmlPreviewVisible() const;
     void setHtmlPreviewVisible(bool visible);
 
+    int htmlPreviewUnloadDelay() const;
+    Q_SLOT void setHtmlPreviewUnloadDelay(int seconds);
+    Q_SIGNAL void htmlPreviewUnloadDelayChanged(int seconds);
+
+    bool exportCacheEnabled() const;
+    Q_SLOT void setExportCacheEnabled(bool enabled);
+    Q_SIGNAL void exportCacheEnabledChanged(bool enabled);
+
+    int exportCacheMaxSize() const;
+    Q_SLOT void setExportCacheMaxSize(int megabytes);
+    Q_SIGNAL void exportCacheMaxSizeChanged(int megabytes);
+
     bool sidebarVisible() const;
     void setSidebarVisible(bool visible);
 
@@ -5,6 +5,7 @@
  */
 
 #include <QApplication>
+#include <QFile>
 #include <QFileInfo>
 #include <QFuture>
 #include <QFutureWatcher>
@@ -12,6 +13,21 @@
 #include <QtConcurrentRun>
 #include <QTextStream>
 
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 27)
+#define GW_HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
 #include "asynctextwriter.h"
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -22,6 +38,28 @@
 
 namespace ghostwriter
 {
+/*
+* Text to be written to a file, along with where and how to write it.
+*/
+struct AsyncTextWrite
+{
+    int revision;
+    QString text;
+    QString fileName;
+    AsyncTextWriter::Encoding encoding;
+    int backupCount;
+};
+
+/*
+* Outcome of writing to disk.  Each string is null if successful,
+* otherwise an error message.
+*/
+struct AsyncTextWriteResult
+{
+    QString writeError;
+    QString backupError;
+};
+
 class AsyncTextWriterPrivate
 {
     Q_DECLARE_PUBLIC(AsyncTextWriter)
@@ -34,20 +72,56 @@ public:
     AsyncTextWriter *q_ptr;
     QString fileName;
     AsyncTextWriter::Encoding encoding;
-    QFutureWatcher<QString> *writeFutureWatcher = nullptr;
+    QFutureWatcher<AsyncTextWriteResult> *writeFutureWatcher = nullptr;
+    int backupCount = 0;
     bool writeInProgress = false;
+    int lastRevision = 0;
+
+    // Revision of the write that is currently running.
+    int currentRevision = 0;
+
+    // Write waiting for the current one to finish, if hasPendingWrite
+    // is true.  Only the newest pending write is kept.
+    //
+    AsyncTextWrite pendingWrite;
+    bool hasPendingWrite = false;
 
     void initialize(const QString &fileName);
 
     /*
-    * Writes the given text to the given file path, returning a null
-    * string if successful, otherwise an error message.  Note that this
-    * method is intended to be run in a separate thread from the main
-    * Qt event loop, and should thus never interact with any widgets.
+    * Starts writing to disk in a separate thread.
+    */
+    void startWrite(const AsyncTextWrite &write);
+
+    /*
+    * Writes the given text to the given file path, first backing up the
+    * file if backupCount is greater than 0.  Note that this method is
+    * intended to be run in a separate thread from the main Qt event loop,
+    * and should thus never interact with any widgets.
     */
-    static QString writeToDisk(const QString &text,
+    static AsyncTextWriteResult writeToDisk(const QString &text,
         const QString &fileName,
-        AsyncTextWriter::Encoding encoding);
+        AsyncTextWriter::Encoding encoding,
+        int backupCount);
+
+    /*
+    * Rotates the existing backups of the given file and backs it up
+    * anew.  Sets linked to true if the backup is a hard link to the
+    * file, which the file must then be replaced rather than overwritten
+    * in place to preserve.  Returns a null string if successful,
+    * otherwise an error message.
+    */
+    static QString backupFile(const QString &fileName,
+        int backupCount,
+        bool &linked);
+
+    /*
+    * Copies a file, sharing its data on disk where supported.  Returns
+    * true if successful.
+    */
+    static bool copyFile(const QString &sourcePath,
+        const QString &destinationPath,
+        QString &err);
 
     /*
     * Handles any errors or tidying up after an asynchronous save operation.
@@ -105,6 +179,20 @@ AsyncTextWriter::Encoding AsyncTextWriter::encoding() const
     return d->encoding;
 }
 
+int AsyncTextWriter::backupCount() const
+{
+    Q_D(const AsyncTextWriter);
+
+    return d->backupCount;
+}
+
+void AsyncTextWriter::setBackupCount(int count)
+{
+    Q_D(AsyncTextWriter);
+
+    d->backupCount = qMax(0, count);
+}
+
 bool AsyncTextWriter::writeInProgress() const
 {
     Q_D(const AsyncTextWriter);
@@ -114,10 +202,18 @@ bool AsyncTextWriter::writeInProgress() const
 
 void AsyncTextWriter::waitForFinished()
 {
-    Q_D(const AsyncTextWriter);
+    Q_D(AsyncTextWriter);
 
-    if (d->writeFutureWatcher->isRunning() || d->writeFutureWatcher->isStarted()) {
+    // Finishing the current write starts the pending one, if any, so keep
+    // waiting until there is nothing left to write.
+    //
+    while (d->writeInProgress) {
         d->writeFutureWatcher->waitForFinished();
+
+        // Deliver the watcher's finished() signal now rather than waiting
+        // for the event loop.
+        //
+        QCoreApplication::sendPostedEvents(d->writeFutureWatcher);
     }
 
     qApp->processEvents();
@@ -131,56 +227,119 @@ bool AsyncTextWriter::write(const QString &text)
         return false;
     }
 
-    if (d->writeFutureWatcher->isRunning()
-            || d->writeFutureWatcher->isStarted()) {
-        d->writeFutureWatcher->waitForFinished();
-    }
+    AsyncTextWrite write;
+    write.revision = ++d->lastRevision;
+    write.text = text;
+    write.fileName = d->fileName;
+    write.encoding = d->encoding;
+    write.backupCount = d->backupCount;
 
-    d->writeInProgress = true;
-
-    QFuture<QString> future =
-        QtConcurrent::run
-        (
-            &AsyncTextWriterPrivate::writeToDisk,
-            text,
-            d->fileName,
-            d->encoding
-        );
-
-    d->writeFutureWatcher->setFuture(future);
+    if (!d->writeInProgress) {
+        d->startWrite(write);
+        return true;
+    }
 
-    if (d->fileName.isNull() || d->fileName.isEmpty()) {
-        return false;
+    // Replace any text that is still waiting, since writing it would
+    // only be overwritten by this text anyway.
+    //
+    if (d->hasPendingWrite) {
+        int supersededRevision = d->pendingWrite.revision;
+
+        d->pendingWrite = write;
+        emit revisionSuperseded(supersededRevision);
+    } else {
+        d->pendingWrite = write;
+        d->hasPendingWrite = true;
     }
 
     return true;
 }
 
+int AsyncTextWriter::lastRevision() const
+{
+    Q_D(const AsyncTextWriter);
+
+    return d->lastRevision;
+}
+
 void AsyncTextWriterPrivate::initialize(const QString &fileName)
 {
     Q_Q(AsyncTextWriter);
 
     this->fileName = QFileInfo(fileName).absoluteFilePath();
     this->encoding = DEFAULT_STREAM_CODEC;
-    this->writeFutureWatcher = new QFutureWatcher<QString>(q);
+    this->writeFutureWatcher = new QFutureWatcher<AsyncTextWriteResult>(q);
 
     q->connect(this->writeFutureWatcher,
-        &QFutureWatcher<QString>::finished,
+        &QFutureWatcher<AsyncTextWriteResult>::finished,
         [this]() {
             this->onWriteCompleted();
         }
     );
 }
 
-QString AsyncTextWriterPrivate::writeToDisk(const QString &text,
+void AsyncTextWriterPrivate::startWrite(const AsyncTextWrite &write)
+{
+    this->writeInProgress = true;
+    this->currentRevision = write.revision;
+
+    QFuture<AsyncTextWriteResult> future =
+        QtConcurrent::run
+        (
+            &AsyncTextWriterPrivate::writeToDisk,
+            write.text,
+            write.fileName,
+            write.encoding,
+            write.backupCount
+        );
+
+    this->writeFutureWatcher->setFuture(future);
+}
+
+AsyncTextWriteResult AsyncTextWriterPrivate::writeToDisk(const QString &text,
     const QString &fileName,
-    AsyncTextWriter::Encoding encoding)
+    AsyncTextWriter::Encoding encoding,
+    int backupCount)
 {
+    AsyncTextWriteResult result;
+    bool linked = false;
+
+    if ((backupCount > 0) && QFile::exists(fileName)) {
+        result.backupError = backupFile(fileName, backupCount, linked);
+    }
+
     QSaveFile file(fileName);
-    file.setDirectWriteFallback(true);
+
+    // Writing directly to the file would also change a backup that is
+    // a hard link to it.
+    //
+    file.setDirectWriteFallback(!linked);
 
     if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
-        return file.errorString();
+        if (!linked) {
+            result.writeError = file.errorString();
+            return result;
+        }
+
+        // Fall back to writing directly to the file, after replacing the
+        // backup with a copy.
+        //
+        QString backupFilePath = fileName + ".backup";
+
+        QFile::remove(backupFilePath);
+
+        QString err;
+
+        if (!copyFile(fileName, backupFilePath, err)) {
+            result.backupError = err;
+        }
+
+        file.setDirectWriteFallback(true);
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            result.writeError = file.errorString();
+            return result;
+        }
     }
 
     // Write contents to disk.
@@ -196,27 +355,174 @@ QString AsyncTextWriterPrivate::writeToDisk(const QString &text,
 
     if (QFile::NoError != file.error()) {
         file.cancelWriting();
-        return file.errorString();
+        result.writeError = file.errorString();
+        return result;
     }
 
     // Commit changes (and close the file).  All done!
     file.commit();
+    return result;
+}
+
+QString AsyncTextWriterPrivate::backupFile(const QString &fileName,
+    int backupCount,
+    bool &linked)
+{
+    QString backupFilePath = fileName + ".backup";
+
+    linked = false;
+
+    // Rotate older backups out of the way, dropping the oldest one.
+    for (int i = backupCount; i > 1; i--) {
+        QString olderFilePath = backupFilePath + "." + QString::number(i);
+        QString newerFilePath = backupFilePath;
+
+        if (i > 2) {
+            newerFilePath += "." + QString::number(i - 1);
+        }
+
+        QFile::remove(olderFilePath);
+
+        if (QFile::exists(newerFilePath)) {
+            QFile::rename(newerFilePath, olderFilePath);
+        }
+    }
+
+    QFile backupFile(backupFilePath);
+
+    if (backupFile.exists() && !backupFile.remove()) {
+        return backupFile.errorString();
+    }
+
+#ifdef Q_OS_UNIX
+    // Since the file is replaced rather than overwritten when saved, a
+    // hard link to it keeps its previous contents without copying them.
+    // Link to the file itself rather than to a symbolic link to it, which
+    // would show the new contents once the symbolic link's target is
+    // replaced.
+    //
+    QString targetFileName = QFileInfo(fileName).canonicalFilePath();
+
+    if (targetFileName.isEmpty()) {
+        targetFileName = fileName;
+    }
+
+    if (0 == ::link(QFile::encodeName(targetFileName).constData(),
+            QFile::encodeName(backupFilePath).constData())) {
+        linked = true;
+        return QString();
+    }
+#endif
+
+    QString err;
+
+    if (!copyFile(fileName, backupFilePath, err)) {
+        return err;
+    }
+
     return QString();
 }
 
+bool AsyncTextWriterPrivate::copyFile(const QString &sourcePath,
+    const QString &destinationPath,
+    QString &err)
+{
+    QFile source(sourcePath);
+
+    if (!source.open(QIODevice::ReadOnly)) {
+        err = source.errorString();
+        return false;
+    }
+
+    QFile destination(destinationPath);
+
+    if (!destination.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err = destination.errorString();
+        return false;
+    }
+
+    bool copied = false;
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    // Share the data with a reflink on file systems that support it.
+    copied = (0 == ::ioctl(destination.handle(), FICLONE, source.handle()));
+#endif
+
+#ifdef GW_HAVE_COPY_FILE_RANGE
+    // Otherwise, let the kernel copy the data without it passing through
+    // user space.
+    //
+    if (!copied) {
+        qint64 remaining = source.size();
+
+        while (remaining > 0) {
+            ssize_t count = ::copy_file_range(source.handle(), nullptr,
+                destination.handle(), nullptr, remaining, 0);
+
+            if (count <= 0) {
+                break;
+            }
+
+            remaining -= count;
+        }
+
+        copied = (0 == remaining);
+
+        // Start over with a plain copy after a partial one.
+        if (!copied) {
+            source.seek(0);
+            destination.seek(0);
+            destination.resize(0);
+        }
+    }
+#endif
+
+    while (!copied && !source.atEnd()) {
+        QByteArray chunk = source.read(64 * 1024);
+
+        if (chunk.isEmpty() || (destination.write(chunk) != chunk.size())) {
+            err = destination.errorString();
+            destination.close();
+            destination.remove();
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void AsyncTextWriterPrivate::onWriteCompleted()
 {
     Q_Q(AsyncTextWriter);
 
-    QString err = this->writeFutureWatcher->result();
+    AsyncTextWriteResult result = this->writeFutureWatcher->result();
+    QString err = result.writeError;
+    int revision = this->currentRevision;
+
+    // Start the pending write, if any, before notifying anyone, so that
+    // writeInProgress() stays true until all of the text is written.
+    //
+    if (this->hasPendingWrite) {
+        AsyncTextWrite write = this->pendingWrite;
+
+        this->pendingWrite = AsyncTextWrite();
+        this->hasPendingWrite = false;
+        startWrite(write);
+    } else {
+        this->writeInProgress = false;
+    }
 
-    this->writeInProgress = false;
+    if (!result.backupError.isNull()) {
+        emit q->backupError(result.backupError);
+    }
 
     if (!err.isNull() && !err.isEmpty()) {
+        emit q->revisionFailed(revision, err);
         emit q->writeError(err);
         return;
     }
 
+    emit q->revisionWritten(revision);
     emit q->writeComplete();
 }
 
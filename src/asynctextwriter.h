@@ -22,6 +22,14 @@ namespace ghostwriter
 {
 /**
  * Writes document text asynchronously to a file.
+ *
+ * Each call to write() is assigned a revision number.  Only one write
+ * runs at a time.  If write() is called while a write is in progress,
+ * the new text is held until the current write finishes, replacing any
+ * text that was already waiting, so that only the latest text is ever
+ * written once the disk catches up.  The outcome of every revision is
+ * reported with the revisionWritten(), revisionSuperseded() or
+ * revisionFailed() signals.
  */
 class AsyncTextWriterPrivate;
 class AsyncTextWriter : public QObject
@@ -71,21 +79,48 @@ public:
     void setEncoding(Encoding encoding);
 
     /**
-     * Returns true if a write is currently in progress, false otherwise.
+     * Returns the number of backups of the file's previous contents that
+     * are kept.
+     */
+    int backupCount() const;
+
+    /**
+     * Sets the number of backups of the file's previous contents to keep.
+     * Before each write, the file is backed up to a file of the same name
+     * with a ".backup" extension, and older backups are rotated to
+     * ".backup.2", ".backup.3", etc.  Backups are made on the same thread
+     * as the write, and share the file's data on disk rather than copying
+     * it where possible.  The default count of 0 disables backups.
+     */
+    void setBackupCount(int count);
+
+    /**
+     * Returns true if a write is currently in progress or waiting to be
+     * started, false otherwise.
      */
     bool writeInProgress() const;
 
     /**
-     * Waits for write to finish (if needed) before returning.
+     * Waits for the current write and any write waiting after it to
+     * finish (if needed) before returning.
      */
     void waitForFinished();
 
     /**
      * Writes the given text to the file.  Note: Previous contents of the file
-     * will be replaced.
+     * will be replaced.  This method never blocks.  If a write is already in
+     * progress, the text will be written once it finishes, unless write() is
+     * called again with newer text before then.  Returns false if no file
+     * name is set, true otherwise.
      */
     bool write(const QString &text);
 
+    /**
+     * Returns the revision number assigned to the text passed to the most
+     * recent successful call to write(), or 0 if nothing was written yet.
+     */
+    int lastRevision() const;
+
 signals:
     /**
      * Emitted when the write is complete.  Signal will not be emitted if
@@ -99,6 +134,29 @@ signals:
      */
     void writeError(const QString &errorString);
 
+    /**
+     * Emitted when backing up the file before a write failed.  The write
+     * itself still goes ahead.
+     */
+    void backupError(const QString &errorString);
+
+    /**
+     * Emitted when the text of the given revision has been written to disk.
+     */
+    void revisionWritten(int revision);
+
+    /**
+     * Emitted when the text of the given revision is dropped without being
+     * written, because newer text was passed to write() while it was
+     * waiting for the previous write to finish.
+     */
+    void revisionSuperseded(int revision);
+
+    /**
+     * Emitted when writing the text of the given revision failed.
+     */
+    void revisionFailed(int revision, const QString &errorString);
+
 private:
     QScopedPointer<AsyncTextWriterPrivate> d_ptr;
 };
@@ -0,0 +1,316 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include "batchexporter.h"
+#include "exportcache.h"
+#include "exporterfactory.h"
+
+namespace ghostwriter
+{
+class BatchExporterPrivate
+{
+public:
+    BatchExporterPrivate()
+        : exporter(nullptr),
+          format(nullptr)
+    {
+        ;
+    }
+
+    ~BatchExporterPrivate()
+    {
+        ;
+    }
+
+    Exporter *exporter;
+    const ExportFormat *format;
+    QString outputDirPath;
+    QThreadPool threadPool;
+
+    // Serializes progress and error messages from the worker threads.
+    QMutex outputMutex;
+
+    /*
+    * Returns the export format supported by the exporter that matches
+    * the given name or file extension, or nullptr if there is none.
+    */
+    static const ExportFormat *findFormat
+    (
+        const Exporter *exporter,
+        const QString &formatName
+    );
+
+    /*
+    * Exports a single file.  Runs on the thread pool.  Returns true if
+    * successful.
+    */
+    bool exportFile(const QString &inputFilePath, const QString &outputFilePath);
+
+    void printMessage(const QString &message);
+};
+
+BatchExporter::BatchExporter(const QString &outputDirPath)
+    : d_ptr(new BatchExporterPrivate())
+{
+    Q_D(BatchExporter);
+
+    d->outputDirPath = outputDirPath;
+    d->threadPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+BatchExporter::~BatchExporter()
+{
+    ;
+}
+
+bool BatchExporter::setExporter
+(
+    const QString &processorName,
+    const QString &formatName,
+    QString &err
+)
+{
+    Q_D(BatchExporter);
+
+    QList<Exporter *> candidates;
+
+    ExporterFactory::instance()->waitForDetectionFinished();
+
+    for (Exporter *exporter : ExporterFactory::instance()->fileExporters()) {
+        if (processorName.isEmpty()
+                || (0 == exporter->name().compare(processorName, Qt::CaseInsensitive))) {
+            candidates.append(exporter);
+        }
+    }
+
+    if (candidates.isEmpty()) {
+        err = QObject::tr("Processor %1 is not available.").arg(processorName);
+        return false;
+    }
+
+    for (Exporter *exporter : candidates) {
+        const ExportFormat *format =
+            BatchExporterPrivate::findFormat(exporter, formatName);
+
+        if (nullptr != format) {
+            d->exporter = exporter;
+            d->format = format;
+            return true;
+        }
+    }
+
+    if (processorName.isEmpty()) {
+        err = QObject::tr("No available processor supports the %1 format.")
+            .arg(formatName);
+    } else {
+        err = QObject::tr("%1 format is not supported by the %2 processor.")
+            .arg(formatName)
+            .arg(candidates.first()->name());
+    }
+
+    return false;
+}
+
+void BatchExporter::setSmartTypographyEnabled(bool enabled)
+{
+    Q_D(BatchExporter);
+
+    if (nullptr != d->exporter) {
+        d->exporter->setSmartTypographyEnabled(enabled);
+    }
+}
+
+void BatchExporter::setMaxThreadCount(int count)
+{
+    Q_D(BatchExporter);
+
+    d->threadPool.setMaxThreadCount(qMax(1, count));
+}
+
+int BatchExporter::exportFiles(const QStringList &inputFilePaths)
+{
+    Q_D(BatchExporter);
+
+    if ((nullptr == d->exporter) || (nullptr == d->format)) {
+        return inputFilePaths.size();
+    }
+
+    QDir outputDir(d->outputDirPath);
+
+    if (!outputDir.mkpath(".")) {
+        d->printMessage(QObject::tr("Could not create directory %1")
+            .arg(d->outputDirPath));
+        return inputFilePaths.size();
+    }
+
+    int failureCount = 0;
+    QSet<QString> outputFilePaths;
+    QList<QFuture<bool>> futures;
+
+    for (const QString &inputFilePath : inputFilePaths) {
+        QFileInfo inputFileInfo(inputFilePath);
+        QString outputFileName = inputFileInfo.completeBaseName();
+
+        if (!d->format->defaultFileExtension().isEmpty()) {
+            outputFileName += "." + d->format->defaultFileExtension();
+        }
+
+        QString outputFilePath = outputDir.absoluteFilePath(outputFileName);
+
+        // Never let two input files with the same base name overwrite
+        // each other's output.
+        //
+        if (outputFilePaths.contains(outputFilePath)) {
+            d->printMessage(QObject::tr("%1: output file %2 is already "
+                "the output of another file").arg(inputFilePath).arg(outputFilePath));
+            failureCount++;
+            continue;
+        }
+
+        outputFilePaths.insert(outputFilePath);
+
+        QString absoluteInputFilePath = inputFileInfo.absoluteFilePath();
+
+        futures.append(
+            QtConcurrent::run
+            (
+                &d->threadPool,
+                [d, absoluteInputFilePath, outputFilePath]() {
+                    return d->exportFile(absoluteInputFilePath, outputFilePath);
+                }
+            )
+        );
+    }
+
+    for (QFuture<bool> &future : futures) {
+        if (!future.result()) {
+            failureCount++;
+        }
+    }
+
+    return failureCount;
+}
+
+const ExportFormat *BatchExporterPrivate::findFormat
+(
+    const Exporter *exporter,
+    const QString &formatName
+)
+{
+    const QList<const ExportFormat *> formats = exporter->supportedFormats();
+
+    for (const ExportFormat *format : formats) {
+        if (0 == format->name().compare(formatName, Qt::CaseInsensitive)) {
+            return format;
+        }
+    }
+
+    for (const ExportFormat *format : formats) {
+        if (0 == format->defaultFileExtension().compare(formatName, Qt::CaseInsensitive)) {
+            return format;
+        }
+    }
+
+    return nullptr;
+}
+
+bool BatchExporterPrivate::exportFile
+(
+    const QString &inputFilePath,
+    const QString &outputFilePath
+)
+{
+    QFile inputFile(inputFilePath);
+
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        printMessage(QString("%1: %2").arg(inputFilePath)
+            .arg(inputFile.errorString()));
+        return false;
+    }
+
+    QTextStream inStream(&inputFile);
+
+    // Markdown files need to be in UTF-8 format, so assume that is
+    // what the file is encoded in, as when opening it in the editor.
+    //
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    inStream.setCodec("UTF-8");
+#else
+    inStream.setEncoding(QStringConverter::Utf8);
+#endif
+    inStream.setAutoDetectUnicode(true);
+
+    QString text = inStream.readAll();
+
+    if (QFile::NoError != inputFile.error()) {
+        printMessage(QString("%1: %2").arg(inputFilePath)
+            .arg(inputFile.errorString()));
+        return false;
+    }
+
+    inputFile.close();
+
+    ExportCache *cache = ExportCache::instance();
+    QByteArray cacheKey;
+
+    if (cache->isEnabled()) {
+        cacheKey = ExportCache::key
+            (
+                exporter,
+                format,
+                inputFilePath,
+                text,
+                exporter->smartTypographyEnabled()
+            );
+
+        if (cache->fetch(cacheKey, outputFilePath)) {
+            printMessage(QObject::tr("Exported %1 to %2 (cached)")
+                .arg(inputFilePath)
+                .arg(outputFilePath));
+            return true;
+        }
+    }
+
+    QString err;
+    exporter->exportToFile(format, inputFilePath, text, outputFilePath, err);
+
+    if (!err.isNull()) {
+        printMessage(QString("%1: %2").arg(inputFilePath).arg(err.trimmed()));
+        return false;
+    }
+
+    if (!cacheKey.isEmpty()) {
+        cache->store(cacheKey, outputFilePath);
+    }
+
+    printMessage(QObject::tr("Exported %1 to %2")
+        .arg(inputFilePath)
+        .arg(outputFilePath));
+    return true;
+}
+
+void BatchExporterPrivate::printMessage(const QString &message)
+{
+    QMutexLocker locker(&outputMutex);
+    QTextStream errStream(stderr);
+
+    errStream << message << Qt::endl;
+}
+} // namespace ghostwriter
@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef BATCHEXPORTER_H
+#define BATCHEXPORTER_H
+
+#include <QScopedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "exporter.h"
+#include "exportformat.h"
+
+namespace ghostwriter
+{
+/**
+ * Exports Markdown files to a directory without a GUI, converting up to
+ * a given number of files in parallel.  Progress and per-file errors are
+ * reported on the standard error output.
+ */
+class BatchExporterPrivate;
+class BatchExporter
+{
+    Q_DECLARE_PRIVATE(BatchExporter)
+
+public:
+    /**
+     * Constructor.  Exported files are written to outputDirPath, which
+     * is created if it does not exist.
+     */
+    BatchExporter(const QString &outputDirPath);
+
+    /**
+     * Destructor.
+     */
+    ~BatchExporter();
+
+    /**
+     * Selects the exporter (i.e., processor) and export format by name.
+     * The format may be given either by its name (e.g., "HTML 5") or by
+     * its default file extension (e.g., "docx").  If processorName is
+     * empty, the first exporter that supports the format is used.
+     * Returns false and sets err if no matching processor or format
+     * was found.
+     */
+    bool setExporter
+    (
+        const QString &processorName,
+        const QString &formatName,
+        QString &err
+    );
+
+    /**
+     * Sets whether to export using smart typography.
+     */
+    void setSmartTypographyEnabled(bool enabled);
+
+    /**
+     * Sets the maximum number of files to convert in parallel.  Defaults
+     * to the number of processor cores.
+     */
+    void setMaxThreadCount(int count);
+
+    /**
+     * Exports the given files, blocking until all are done.  Returns the
+     * number of files that failed to export.
+     */
+    int exportFiles(const QStringList &inputFilePaths);
+
+private:
+    QScopedPointer<BatchExporterPrivate> d_ptr;
+};
+} // namespace ghostwriter
+
+#endif // BATCHEXPORTER_H
@@ -91,7 +91,12 @@ MarkdownAST *CmarkGfmAPI::parse(const QString &text, const bool smartTypographyE
     return ast;
 }
 
-QString CmarkGfmAPI::renderToHtml(const QString &text, const bool smartTypographyEnabled)
+QString CmarkGfmAPI::renderToHtml
+(
+    const QString &text,
+    const bool smartTypographyEnabled,
+    const bool sourcePositionsEnabled
+)
 {
     Q_D(CmarkGfmAPI);
     
@@ -101,6 +106,10 @@ QString CmarkGfmAPI::renderToHtml(const QString &text, const bool smartTypograph
         opts |= CMARK_OPT_SMART;
     }
 
+    if (sourcePositionsEnabled) {
+        opts |= CMARK_OPT_SOURCEPOS;
+    }
+
     d->apiMutex.lock();
 
     cmark_mem *mem = cmark_get_arena_mem_allocator();
@@ -126,6 +135,92 @@ QString CmarkGfmAPI::renderToHtml(const QString &text, const bool smartTypograph
     return html;
 }
 
+bool CmarkGfmAPI::renderToHtml
+(
+    const QString &text,
+    QIODevice *device,
+    const bool smartTypographyEnabled
+)
+{
+    Q_D(CmarkGfmAPI);
+
+    int opts = CMARK_OPT_DEFAULT | CMARK_OPT_FOOTNOTES | CMARK_OPT_UNSAFE;
+
+    if (smartTypographyEnabled) {
+        opts |= CMARK_OPT_SMART;
+    }
+
+    // Use the default allocator rather than the arena, so that each
+    // rendered chunk can be freed as soon as it is written.  Since the
+    // arena is not used, there is no need to lock the API mutex either.
+    //
+    cmark_mem *mem = cmark_get_default_mem_allocator();
+    cmark_parser *parser = cmark_parser_new_with_mem(opts, mem);
+
+    cmark_parser_attach_syntax_extension(parser, d->tableExt);
+    cmark_parser_attach_syntax_extension(parser, d->strikethroughExt);
+    cmark_parser_attach_syntax_extension(parser, d->autolinkExt);
+    cmark_parser_attach_syntax_extension(parser, d->tagfilterExt);
+    cmark_parser_attach_syntax_extension(parser, d->tasklistExt);
+
+    {
+        QByteArray utf8Text = text.toUtf8();
+        cmark_parser_feed(parser, utf8Text.data(), utf8Text.length());
+    }
+
+    cmark_node *root = cmark_parser_finish(parser);
+    cmark_llist *extensions = cmark_parser_get_syntax_extensions(parser);
+    cmark_node *footnotes = nullptr;
+    bool success = true;
+
+    // Footnote definitions are gathered at the end of the document, and
+    // must be rendered together to share one footnotes section.  Move
+    // them under a separate document node to render as the last chunk.
+    //
+    for (cmark_node *node = cmark_node_first_child(root); nullptr != node; ) {
+        cmark_node *next = cmark_node_next(node);
+
+        if (CMARK_NODE_FOOTNOTE_DEFINITION == cmark_node_get_type(node)) {
+            if (nullptr == footnotes) {
+                footnotes = cmark_node_new_with_mem(CMARK_NODE_DOCUMENT, mem);
+            }
+
+            cmark_node_append_child(footnotes, node);
+        }
+
+        node = next;
+    }
+
+    // Render and write each top-level block in turn.
+    cmark_node *node = cmark_node_first_child(root);
+
+    while (success && (nullptr != node)) {
+        char *output = cmark_render_html(node, opts, extensions);
+        qint64 length = qstrlen(output);
+
+        success = (device->write(output, length) == length);
+        mem->free(output);
+        node = cmark_node_next(node);
+    }
+
+    if (nullptr != footnotes) {
+        if (success) {
+            char *output = cmark_render_html(footnotes, opts, extensions);
+            qint64 length = qstrlen(output);
+
+            success = (device->write(output, length) == length);
+            mem->free(output);
+        }
+
+        cmark_node_free(footnotes);
+    }
+
+    cmark_node_free(root);
+    cmark_parser_free(parser);
+
+    return success;
+}
+
 CmarkGfmAPI::CmarkGfmAPI()
     : d_ptr(new CmarkGfmAPIPrivate())
 {
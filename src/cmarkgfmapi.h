@@ -7,6 +7,7 @@
 #ifndef CMARK_PROCESSOR_H
 #define CMARK_PROCESSOR_H
 
+#include <QIODevice>
 #include <QScopedPointer>
 
 #include "markdownast.h"
@@ -41,9 +42,31 @@ public:
 
     /**
      * Returns HTML text for the Markdown text.  Pass in true for
-     * smartTypographyEnabled to enable smart typography.
+     * smartTypographyEnabled to enable smart typography.  Pass in true
+     * for sourcePositionsEnabled to annotate block elements with a
+     * data-sourcepos attribute giving their Markdown source line and
+     * column range.
      */
-    QString renderToHtml(const QString &text, const bool smartTypographyEnabled);
+    QString renderToHtml
+    (
+        const QString &text,
+        const bool smartTypographyEnabled,
+        const bool sourcePositionsEnabled = false
+    );
+
+    /**
+     * Renders HTML for the Markdown text directly to the given device
+     * as UTF-8, one top-level block at a time, so that the complete HTML
+     * is never held in memory.  Pass in true for smartTypographyEnabled
+     * to enable smart typography.  Returns false if writing to the
+     * device failed.
+     */
+    bool renderToHtml
+    (
+        const QString &text,
+        QIODevice *device,
+        const bool smartTypographyEnabled
+    );
 
 protected:
     /**
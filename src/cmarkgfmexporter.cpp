@@ -4,14 +4,15 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
-#include <QFile>
 #include <QFileInfo>
 #include <QObject>
-#include <QTextStream>
+#include <QSaveFile>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "../3rdparty/cmark-gfm/src/cmark-gfm.h"
+
 #include "cmarkgfmexporter.h"
 
 #include "cmarkgfmapi.h"
@@ -21,6 +22,7 @@ namespace ghostwriter
 CmarkGfmExporter::CmarkGfmExporter() : Exporter("cmark-gfm")
 {
     m_supportedFormats.append(ExportFormat::HTML);
+    setVersion(QString::fromLatin1(cmark_version_string()));
 }
 
 CmarkGfmExporter::~CmarkGfmExporter()
@@ -28,9 +30,20 @@ CmarkGfmExporter::~CmarkGfmExporter()
 
 }
 
-void CmarkGfmExporter::exportToHtml(const QString &text, QString &html)
+void CmarkGfmExporter::exportToHtml
+(
+    const QString &text,
+    const bool smartTypographyEnabled,
+    const bool sourcePositionsEnabled,
+    QString &html
+)
 {
-    html = CmarkGfmAPI::instance()->renderToHtml(text, this->m_smartTypographyEnabled);
+    html = CmarkGfmAPI::instance()->renderToHtml
+        (
+            text,
+            smartTypographyEnabled,
+            sourcePositionsEnabled
+        );
 }
 
 void CmarkGfmExporter::exportToFile
@@ -39,52 +52,57 @@ void CmarkGfmExporter::exportToFile
     const QString &inputFilePath,
     const QString &text,
     const QString &outputFilePath,
+    const bool smartTypographyEnabled,
     QString &err
 )
 {
     Q_UNUSED(inputFilePath);
 
-    QString html;
-
     if (ExportFormat::HTML != format) {
         err = QObject::tr("%1 format is unsupported by the cmark-gfm processor.")
               .arg(format->name());
         return;
     }
 
-    exportToHtml(text, html);
-
-    if (html.isNull()) {
-        err = QObject::tr("Export failed");
-        return;
-    }
-
-    QFile outputFile(outputFilePath);
+    // Write to a temporary file that replaces the output file only once
+    // it has been written in full.
+    //
+    QSaveFile outputFile(outputFilePath);
 
-    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    if (!outputFile.open(QIODevice::WriteOnly)) {
         err = outputFile.errorString();
         return;
     }
 
-    // Write contents to disk.
-    QTextStream outStream(&outputFile);
-
     // Specify the character set (UTF-8) for the HTML document.
     // Browsers typically can't tell if the HTML has unicode characters
     // unless UTF-8 is specified in the <head> section.
     //
-    outStream << "<html><head><meta http-equiv=\"Content-Type\" "
+    outputFile.write("<html><head><meta http-equiv=\"Content-Type\" "
               "content=\"text/html; charset=utf-8\" />"
-              "<title></title></head><body>";
+              "<title></title></head><body>");
+
+    // Stream the HTML to the file as it is rendered, rather than
+    // rendering the entire document into memory first.
+    //
+    bool success = CmarkGfmAPI::instance()->renderToHtml
+        (
+            text,
+            &outputFile,
+            smartTypographyEnabled
+        );
 
-    outStream << html;
-    outStream << "</body></html>";
+    outputFile.write("</body></html>");
 
-    if (QFile::NoError != outputFile.error()) {
+    if (!success || (QFileDevice::NoError != outputFile.error())) {
         err = outputFile.errorString();
+        outputFile.cancelWriting();
+        return;
     }
 
-    // Close the file.  All done!
-    outputFile.close();
+    // Commit the file.  All done!
+    if (!outputFile.commit()) {
+        err = outputFile.errorString();
+    }
 }
 }
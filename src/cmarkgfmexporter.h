@@ -31,7 +31,13 @@ public:
      * Exports the given Markdown text to HTML, setting the html parameter
      * to have the HTML output.
      */
-    void exportToHtml(const QString &text, QString &html) override;
+    void exportToHtml
+    (
+        const QString &text,
+        const bool smartTypographyEnabled,
+        const bool sourcePositionsEnabled,
+        QString &html
+    ) override;
 
     /**
      * Exports the given Markdown text to the given export format and
@@ -45,6 +51,7 @@ public:
         const QString &inputFilePath,
         const QString &text,
         const QString &outputFilePath,
+        const bool smartTypographyEnabled,
         QString &err
     ) override;
 };
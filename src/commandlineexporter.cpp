@@ -31,6 +31,21 @@ public:
     QString smartTypographyOffArgument = "";
     QString htmlRenderCommand = QString();
 
+    /*
+    * Sets up the given process to run the command, expanding the output
+    * file path and smart typography variables in it, and then starts it.
+    * The text input is written to the process's standard input.
+    */
+    void startCommand
+    (
+        QProcess &process,
+        const QString &command,
+        const QString &inputFilePath,
+        const QString &textInput,
+        const QString &outputFilePath,
+        const bool smartTypographyEnabled
+    );
+
     bool executeCommand
     (
         const QString &command,
@@ -111,9 +126,18 @@ void CommandLineExporter::setMathSupported(bool supported)
     m_mathSupported = supported;
 }
 
-void CommandLineExporter::exportToHtml(const QString &text, QString &html)
+void CommandLineExporter::exportToHtml
+(
+    const QString &text,
+    const bool smartTypographyEnabled,
+    const bool sourcePositionsEnabled,
+    QString &html
+)
 {
     Q_D(CommandLineExporter);
+
+    // Command line processors have no way to annotate source positions.
+    Q_UNUSED(sourcePositionsEnabled)
     
     QString stderrOutput;
 
@@ -130,7 +154,7 @@ void CommandLineExporter::exportToHtml(const QString &text, QString &html)
             QString(),
             text,
             QString(),
-            this->m_smartTypographyEnabled,
+            smartTypographyEnabled,
             html,
             stderrOutput
         )
@@ -153,6 +177,7 @@ void CommandLineExporter::exportToFile
     const QString &inputFilePath,
     const QString &text,
     const QString &outputFilePath,
+    const bool smartTypographyEnabled,
     QString &err
 )
 {
@@ -177,7 +202,7 @@ void CommandLineExporter::exportToFile
             inputFilePath,
             text,
             outputFilePath,
-            this->m_smartTypographyEnabled,
+            smartTypographyEnabled,
             stdoutOutput,
             stderrOutput
         )
@@ -193,18 +218,50 @@ void CommandLineExporter::exportToFile
     }
 }
 
-bool CommandLineExporterPrivate::executeCommand
+QProcess *CommandLineExporter::startFileExport
 (
+    const ExportFormat *format,
+    const QString &inputFilePath,
+    const QString &text,
+    const QString &outputFilePath,
+    const bool smartTypographyEnabled,
+    QString &err
+)
+{
+    Q_D(CommandLineExporter);
+
+    if (!d->formatToCommandMap.contains(format)) {
+        err = QObject::tr("%1 format is not supported by this processor.")
+            .arg(format->name());
+        return nullptr;
+    }
+
+    QProcess *process = new QProcess();
+
+    d->startCommand
+    (
+        *process,
+        d->formatToCommandMap.value(format),
+        inputFilePath,
+        text,
+        outputFilePath,
+        smartTypographyEnabled
+    );
+
+    err = QString();
+    return process;
+}
+
+void CommandLineExporterPrivate::startCommand
+(
+    QProcess &process,
     const QString &command,
     const QString &inputFilePath,
     const QString &textInput,
     const QString &outputFilePath,
-    const bool smartTypographyEnabled,
-    QString &stdoutOutput,
-    QString &stderrOutput
+    const bool smartTypographyEnabled
 )
 {
-    QProcess process;
     process.setReadChannel(QProcess::StandardOutput);
 
     QString expandedCommand = command + " ";
@@ -262,14 +319,39 @@ bool CommandLineExporterPrivate::executeCommand
     process.startCommand(expandedCommand);
 #endif
 
+    // The input is buffered until the process has started.
+    if (!textInput.isNull() && !textInput.isEmpty()) {
+        process.write(textInput.toUtf8());
+        process.closeWriteChannel();
+    }
+}
+
+bool CommandLineExporterPrivate::executeCommand
+(
+    const QString &command,
+    const QString &inputFilePath,
+    const QString &textInput,
+    const QString &outputFilePath,
+    const bool smartTypographyEnabled,
+    QString &stdoutOutput,
+    QString &stderrOutput
+)
+{
+    QProcess process;
+
+    startCommand
+    (
+        process,
+        command,
+        inputFilePath,
+        textInput,
+        outputFilePath,
+        smartTypographyEnabled
+    );
+
     if (!process.waitForStarted()) {
         return false;
     } else {
-        if (!textInput.isNull() && !textInput.isEmpty()) {
-            process.write(textInput.toUtf8());
-            process.closeWriteChannel();
-        }
-
         if (!process.waitForFinished()) {
             return false;
         } else {
@@ -9,6 +9,7 @@
 
 #include <QString>
 #include <QMap>
+#include <QProcess>
 
 #include "exporter.h"
 
@@ -87,7 +88,13 @@ public:
      * Exports the given text to html, returning the HTML in the html
      * parameter for use in the Live HTML Preview.
      */
-    void exportToHtml(const QString &text, QString &html) override;
+    void exportToHtml
+    (
+        const QString &text,
+        const bool smartTypographyEnabled,
+        const bool sourcePositionsEnabled,
+        QString &html
+    ) override;
 
     /**
      * Exports the given text to the given format and output file path.
@@ -100,9 +107,29 @@ public:
         const QString &inputFilePath,
         const QString &text,
         const QString &outputFilePath,
+        const bool smartTypographyEnabled,
         QString &err
     ) override;
 
+    /**
+     * Starts exporting the given text to the given format and output
+     * file path in a new process, without waiting for the process to
+     * finish.  The text is written to the process's standard input.
+     * The caller takes ownership of the returned process, and can
+     * monitor it with QProcess's finished() and errorOccurred() signals,
+     * or kill it to cancel the export.  Returns nullptr and sets err
+     * if the format is not supported by this processor.
+     */
+    QProcess *startFileExport
+    (
+        const ExportFormat *format,
+        const QString &inputFilePath,
+        const QString &text,
+        const QString &outputFilePath,
+        const bool smartTypographyEnabled,
+        QString &err
+    );
+
     /**
      * Contains the variable string for output file path.  Callers can
      * set this exporter to use a command having the output file path
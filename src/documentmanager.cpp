@@ -6,6 +6,7 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
@@ -14,6 +15,7 @@
 #include <QPair>
 #include <QString>
 #include <QStandardPaths>
+#include <QTextCursor>
 #include <QTextDocument>
 #include <QTextStream>
 #include <QTimer>
@@ -21,6 +23,7 @@
 #include "asynctextwriter.h"
 #include "library.h"
 #include "documentmanager.h"
+#include "editjournal.h"
 #include "exportdialog.h"
 #include "exporter.h"
 #include "exporterfactory.h"
@@ -38,6 +41,21 @@ class DocumentManagerPrivate
 public:
     static const QString FILE_CHOOSER_FILTER;
 
+    /*
+    * Approximate number of bytes of a file to add to the document at a
+    * time while loading it.
+    */
+    static const qint64 LOAD_CHUNK_SIZE = 1024 * 1024;
+
+    /*
+    * While the edit journal is smaller than this many bytes (or the
+    * document's length, if larger), autosave only synchronizes the
+    * journal to disk rather than rewriting the whole file, unless the
+    * file has not been rewritten for FULL_SAVE_INTERVAL milliseconds.
+    */
+    static const qint64 JOURNAL_COMPACT_SIZE = 256 * 1024;
+    static const qint64 FULL_SAVE_INTERVAL = 10 * 60 * 1000;
+
     DocumentManagerPrivate
     (
         DocumentManager *q_ptr
@@ -61,7 +79,10 @@ public:
     QFileSystemWatcher *fileWatcher;
     bool fileHistoryEnabled;
     bool createBackupOnSave;
+    int backupCount;
     AsyncTextWriter *writer;
+    EditJournal *journal;
+    QElapsedTimer fullSaveTimer;
 
     /*
     * This flag is used to prevent notifying the user that the document
@@ -73,6 +94,9 @@ public:
     /*
     * This timer's timeout signal is connected to the autoSaveFile() slot,
     * which saves the document if it can be saved and has been modified.
+    * It is a single shot timer that is (re)armed only when the document
+    * text is revised, so that it does not wake up while the user is
+    * idle or when only the text formatting changes.
     */
     QTimer *autoSaveTimer;
     bool autoSaveEnabled;
@@ -99,6 +123,13 @@ public:
     */
     bool loadFile(const QString &filePath);
 
+    /*
+    * Reads the open file into the document in chunks, emitting the
+    * operationUpdate() signal with the progress after each chunk.
+    * Returns false if the file could not be read.
+    */
+    bool appendFileData(QFile &file);
+
     /*
     * Sets the file path for the document, such that the file will be
     * monitored for external changes made to it, and the display name
@@ -134,17 +165,21 @@ public:
     ) const;
 
     /*
-    * Creates a backup file with a ".backup" extension of the file having
-    * the specified path.  Note that this method is intended to be run in
-    * a separate thread from the main Qt event loop, and should thus never
-    * interact with any widgets.
+    * Handles autosave operation upon autosave timer expiration.
     */
-    void backupFile(const QString &filePath) const;
+    void autoSaveFile();
 
     /*
-    * Handles autosave operation upon autosave timer expiration.
+    * Records the edit to the document reported by its textEdited()
+    * signal in the edit journal.
     */
-    void autoSaveFile();
+    void journalEdit(int position, int charsRemoved, int charsAdded);
+
+    /*
+    * Offers to restore the unsaved changes to the loaded file found in
+    * its edit journal, if any, and starts a new journal for the file.
+    */
+    void recoverJournal(const QString &filePath);
 
     /*
     * Returns true if document is named as "untitled" and located in the
@@ -177,6 +212,7 @@ DocumentManager::DocumentManager
     d->editor = editor;
     d->fileHistoryEnabled = true;
     d->createBackupOnSave = true;
+    d->backupCount = 1;
     d->saveInProgress = false;
     d->autoSaveEnabled = false;
     d->documentModifiedNotifVisible = false;
@@ -197,11 +233,14 @@ DocumentManager::DocumentManager
     d->writer->setEncoding(QStringConverter::Utf8);
 #endif
 
+    d->writer->setBackupCount(d->backupCount);
+
     this->connect(
         d->writer,
         &AsyncTextWriter::writeComplete,
         [d]() {
-            d->saveInProgress = false;
+            // Newer text may already be on its way to disk.
+            d->saveInProgress = d->writer->writeInProgress();
             d->document->setTimestamp(QDateTime::currentDateTime());
 
             if (!d->fileWatcher->files().contains(d->writer->fileName())) {
@@ -210,6 +249,51 @@ DocumentManager::DocumentManager
         }
     );
 
+    this->connect(
+        d->writer,
+        &AsyncTextWriter::backupError,
+        [d](const QString &err) {
+            MessageBoxHelper::critical(
+                d->editor,
+                DocumentManager::tr("File backup failed"),
+                err
+            );
+        }
+    );
+
+    d->journal = new EditJournal(this);
+
+    this->connect(
+        d->writer,
+        &AsyncTextWriter::revisionWritten,
+        d->journal,
+        &EditJournal::commit
+    );
+
+    this->connect(
+        d->writer,
+        &AsyncTextWriter::revisionSuperseded,
+        d->journal,
+        &EditJournal::discard
+    );
+
+    this->connect(
+        d->writer,
+        &AsyncTextWriter::revisionFailed,
+        d->journal,
+        [d](int revision) {
+            d->journal->discard(revision);
+        }
+    );
+
+    this->connect(
+        d->document,
+        &MarkdownDocument::textEdited,
+        [d](int position, int charsRemoved, int charsAdded) {
+            d->journalEdit(position, charsRemoved, charsAdded);
+        }
+    );
+
     this->connect(
         d->writer,
         &AsyncTextWriter::writeError,
@@ -222,13 +306,15 @@ DocumentManager::DocumentManager
                 );
             }
 
-            d->saveInProgress = false;
+            d->saveInProgress = d->writer->writeInProgress();
         }
     );
 
-    // Set up auto-save timer to save the file once every minute.
+    // Set up auto-save timer to save the file within a minute of the
+    // document text being revised.
     d->autoSaveTimer = new QTimer(this);
-    d->autoSaveTimer->start(60000);
+    d->autoSaveTimer->setSingleShot(true);
+    d->autoSaveTimer->setInterval(60000);
 
     this->connect(d->autoSaveTimer,
         &QTimer::timeout,
@@ -237,6 +323,17 @@ DocumentManager::DocumentManager
         }
     );
 
+    this->connect(d->document,
+        &MarkdownDocument::contentsRevised,
+        [d]() {
+            if (d->autoSaveEnabled
+                    && !d->document->isLoading()
+                    && !d->autoSaveTimer->isActive()) {
+                d->autoSaveTimer->start();
+            }
+        }
+    );
+
     connect(d->document,
         &MarkdownDocument::modificationChanged,
         [this, d](bool modified) {
@@ -247,6 +344,7 @@ DocumentManager::DocumentManager
 
             if (modified
                     && d->autoSaveEnabled 
+                    && !d->document->isLoading()
                     && d->document->isNew()
                     && (!d->document->isEmpty())) {
                 d->createDraft();
@@ -264,7 +362,12 @@ DocumentManager::DocumentManager
 
 DocumentManager::~DocumentManager()
 {
-    ;
+    Q_D(DocumentManager);
+
+    // Keep the journal if the document was never closed, as may happen
+    // when the session ends abruptly.
+    //
+    d->journal->close(false);
 }
 
 MarkdownDocument *DocumentManager::document() const
@@ -294,9 +397,17 @@ void DocumentManager::setAutoSaveEnabled(bool enabled)
             d->createDraft();
         }
 
+        if (d->document->isModified()) {
+            d->autoSaveTimer->start();
+        }
+
         emit documentModifiedChanged(false);
-    } else if (d->document->isModified()) {
-        d->document->setModified(false);
+    } else {
+        d->autoSaveTimer->stop();
+
+        if (d->document->isModified()) {
+            d->document->setModified(false);
+        }
     }
 }
 
@@ -307,11 +418,30 @@ bool DocumentManager::fileBackupEnabled() const
     return d->createBackupOnSave;
 }
 
+int DocumentManager::fileBackupCount() const
+{
+    Q_D(const DocumentManager);
+
+    return d->backupCount;
+}
+
 void DocumentManager::setFileBackupEnabled(bool enabled)
 {
     Q_D(DocumentManager);
     
     d->createBackupOnSave = enabled;
+    d->writer->setBackupCount(enabled ? d->backupCount : 0);
+}
+
+void DocumentManager::setFileBackupCount(int count)
+{
+    Q_D(DocumentManager);
+
+    d->backupCount = qMax(1, count);
+
+    if (d->createBackupOnSave) {
+        d->writer->setBackupCount(d->backupCount);
+    }
 }
 
 void DocumentManager::setDraftLocation(const QString &directory) 
@@ -423,6 +553,10 @@ void DocumentManager::reload()
 {
     Q_D(DocumentManager);
     
+    if (d->document->isLoading()) {
+        return;
+    }
+
     if (!d->document->isNew()) {
         if (d->document->isModified()) {
             // Prompt user if he wants to save changes.
@@ -455,6 +589,10 @@ void DocumentManager::rename()
 {
     Q_D(DocumentManager);
     
+    if (d->document->isLoading()) {
+        return;
+    }
+
     if (d->document->isNew()) {
         saveAs();
     } else {
@@ -519,6 +657,13 @@ bool DocumentManager::save()
 {
     Q_D(DocumentManager);
     
+    // The document only holds part of the file being opened, and still
+    // has the file path of the document it replaces.
+    //
+    if (d->document->isLoading()) {
+        return false;
+    }
+
     if (d->document->isNew() || !d->checkPermissionsBeforeSave()) {
         return this->saveAs();
     } else {
@@ -531,6 +676,10 @@ bool DocumentManager::saveAs()
 {
     Q_D(DocumentManager);
     
+    if (d->document->isLoading()) {
+        return false;
+    }
+
     QString startingDirectory = QString();
 
     if (!d->document->isNew()) {
@@ -552,9 +701,10 @@ bool DocumentManager::saveAs()
             draftFile.remove();
 
             QString backupFilePath = d->document->filePath() + ".backup";
-            QFile backupFile(backupFilePath);
-            if (backupFile.exists()) {
-                backupFile.remove();
+            QFile::remove(backupFilePath);
+
+            for (int i = 2; i <= d->backupCount; i++) {
+                QFile::remove(backupFilePath + "." + QString::number(i));
             }
         }
         d->setFilePath(filePath);
@@ -569,11 +719,19 @@ bool DocumentManager::close()
 {
     Q_D(DocumentManager);
     
+    // The file being opened is still being added to the document.
+    if (d->document->isLoading()) {
+        return false;
+    }
+
     if (d->checkSaveChanges()) {
         if (d->writer->writeInProgress()) {
             d->writer->waitForFinished();
         }
 
+        // Any changes have been either saved or discarded by now.
+        d->journal->close(true);
+
         // Get the document's information before closing it out
         // so we can store history information about it.
         //
@@ -626,11 +784,11 @@ void DocumentManager::exportFile()
 {
     Q_D(DocumentManager);
     
-    ExportDialog exportDialog(d->document);
-
-    connect(&exportDialog, SIGNAL(exportStarted(QString)), this, SIGNAL(operationStarted(QString)));
-    connect(&exportDialog, SIGNAL(exportComplete()), this, SIGNAL(operationFinished()));
+    if (d->document->isLoading()) {
+        return;
+    }
 
+    ExportDialog exportDialog(d->document);
     exportDialog.exec();
 }
 
@@ -702,14 +860,22 @@ void DocumentManagerPrivate::saveFile()
     document->setTimestamp(QDateTime::currentDateTime());
     saveInProgress = true;
 
-    // If backup is enabled, back up the file first.
-    if (createBackupOnSave) {
-        backupFile(writer->fileName());
-    }
+    QString text = document->plainText();
+    bool status = writer->write(text);
 
-    bool status = writer->write(document->toPlainText());
+    if (status) {
+        fullSaveTimer.start();
 
-    if (!status) {
+        // A journal started from the text being saved only becomes
+        // usable once the text is in the file, which is fine, since
+        // there is nothing to recover until then.
+        //
+        if (journal->filePath() != writer->fileName()) {
+            journal->open(writer->fileName(), text);
+        } else {
+            journal->checkpoint(writer->lastRevision(), text);
+        }
+    } else {
         MessageBoxHelper::critical(
             editor,
             DocumentManager::tr("Error saving %1").arg(writer->fileName()),
@@ -724,6 +890,13 @@ bool DocumentManagerPrivate::loadFile(const QString &filePath)
 {
     Q_Q(DocumentManager);
 
+    // Events are processed while a file loads, so don't let another file
+    // be opened in the middle of it.
+    //
+    if (document->isLoading()) {
+        return false;
+    }
+
     QFileInfo fileInfo(filePath);
     QFile inputFile(filePath);
 
@@ -735,6 +908,11 @@ bool DocumentManagerPrivate::loadFile(const QString &filePath)
         return false;
     }
 
+    // The changes to the document being replaced have been either saved
+    // or discarded by now.
+    //
+    journal->close(true);
+
     // NOTE: Must set editor's text cursor to the beginning
     // of the document before clearing the document/editor
     // of text to prevent a crash in Qt 5.10 on opening or
@@ -751,35 +929,47 @@ bool DocumentManagerPrivate::loadFile(const QString &filePath)
 
     QApplication::setOverrideCursor(Qt::WaitCursor);
     emit q->operationStarted(DocumentManager::tr("opening %1").arg(filePath));
-    QTextStream inStream(&inputFile);
 
-    // Markdown files need to be in UTF-8 format, so assume that is
-    // what the user is opening by default.  Enable autodetection
-    // of of UTF-16 or UTF-32 BOM in case the file isn't UTF-8 encoded.
+    // Keep the editor and analysis of the text (parsing, highlighting,
+    // spell checking, statistics) out of the way until all of the text
+    // is in.  Events are processed between chunks, and the document is
+    // modified but still has the previous file's path until then, so
+    // don't let autosave write the partial text over the previous file.
     //
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    inStream.setCodec("UTF-8");
-#else
-    inStream.setEncoding(QStringConverter::Utf8);
-#endif
-    inStream.setAutoDetectUnicode(true);
-
-    QString text = inStream.readAll();
+    editor->setReadOnly(true);
+    document->setLoading(true);
+    autoSaveTimer->stop();
 
-    if (QFile::NoError != inputFile.error()) {
+    if (!appendFileData(inputFile)) {
         MessageBoxHelper::critical(editor,
             DocumentManager::tr("Could not read %1").arg(filePath),
             inputFile.errorString()
         );
 
         inputFile.close();
+
+        // Leave an untitled document rather than a partial file that
+        // could be saved over the previous one.
+        //
+        document->clear();
+        document->setLoading(false);
+        document->setUndoRedoEnabled(true);
+        editor->setReadOnly(false);
+        document->setReadOnly(false);
+        setFilePath(QString());
+        document->setModified(false);
+
+        emit q->operationFinished();
+        emit q->documentModifiedChanged(false);
+        QApplication::restoreOverrideCursor();
+        emit q->documentClosed();
         return false;
     }
 
     inputFile.close();
-    
+
     setFilePath(filePath);
-    editor->setPlainText(text);
+    document->setLoading(false);
     editor->navigateDocument(0);
     emit q->operationUpdate();
 
@@ -813,12 +1003,120 @@ bool DocumentManagerPrivate::loadFile(const QString &filePath)
     emit q->documentModifiedChanged(false);
     QApplication::restoreOverrideCursor();
 
+    fullSaveTimer.start();
+    recoverJournal(filePath);
+
     editor->centerCursor();
     emit q->documentLoaded();
 
     return true;
 }
 
+bool DocumentManagerPrivate::appendFileData(QFile &file)
+{
+    Q_Q(DocumentManager);
+
+    QTextCursor cursor(document);
+    qint64 size = file.size();
+    int lastPercent = -1;
+
+    // Read the file a chunk at a time rather than mapping it into memory,
+    // since events are processed between chunks, during which time the
+    // file could be truncated by another program.
+    //
+    QByteArray pending = file.read(LOAD_CHUNK_SIZE);
+
+    if (QFile::NoError != file.error()) {
+        return false;
+    }
+
+    // Markdown files need to be in UTF-8 format, so assume that is what
+    // the user is opening, skipping its BOM if there is one.  Files with
+    // a UTF-16 or UTF-32 BOM are decoded all at once by QTextStream.
+    //
+    if (pending.startsWith("\xFF\xFE")
+            || pending.startsWith("\xFE\xFF")
+            || pending.startsWith(QByteArray("\x00\x00\xFE\xFF", 4))) {
+        pending += file.readAll();
+
+        if (QFile::NoError != file.error()) {
+            return false;
+        }
+
+        QTextStream inStream(pending);
+        inStream.setAutoDetectUnicode(true);
+
+        cursor.insertText(inStream.readAll());
+        return true;
+    }
+
+    if (pending.startsWith("\xEF\xBB\xBF")) {
+        pending.remove(0, 3);
+    }
+
+    bool atEnd = pending.isEmpty();
+
+    while (!atEnd) {
+        QByteArray chunk = file.read(LOAD_CHUNK_SIZE);
+
+        if (QFile::NoError != file.error()) {
+            return false;
+        }
+
+        atEnd = chunk.isEmpty();
+        pending += chunk;
+
+        // End each chunk after a line break, so that no UTF-8 sequence
+        // or CR LF pair is split between two chunks.  Failing that for
+        // a very long line, end it before a UTF-8 lead byte.  Whatever
+        // is left over is added with the next chunk.
+        //
+        int end = pending.size();
+
+        if (!atEnd) {
+            end = pending.lastIndexOf('\n') + 1;
+
+            if (end <= 0) {
+                end = pending.size() - 1;
+
+                while ((end > 0) && (0x80 == (pending.at(end) & 0xC0))) {
+                    end--;
+                }
+
+                if ((end > 0) && ('\r' == pending.at(end - 1))) {
+                    end--;
+                }
+            }
+        }
+
+        if (end <= 0) {
+            continue;
+        }
+
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(QString::fromUtf8(pending.constData(), end));
+        pending.remove(0, end);
+
+        // Receivers of this signal update the status bar and process
+        // pending events, which keeps the application responsive.
+        //
+        int percent = 100;
+
+        if (!atEnd && (size > 0)) {
+            percent = (int) qMin((qint64) 100, ((file.pos() - pending.size()) * 100) / size);
+        }
+
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            emit q->operationUpdate(DocumentManager::tr("opening %1 (%2%)")
+                .arg(file.fileName())
+                .arg(percent));
+        }
+    }
+
+    return true;
+}
+
 void DocumentManagerPrivate::setFilePath(const QString &filePath)
 {
     Q_Q(DocumentManager);
@@ -830,6 +1128,11 @@ void DocumentManagerPrivate::setFilePath(const QString &filePath)
     document->setFilePath(filePath);
     writer->setFileName(filePath);
 
+    // The journal's edits are saved to the new file once it is written.
+    if (journal->isOpen() && (journal->filePath() != writer->fileName())) {
+        journal->close(true);
+    }
+
     if (!filePath.isNull() && !filePath.isEmpty()) {
         QFileInfo fileInfo(filePath);
 
@@ -935,35 +1238,6 @@ bool DocumentManagerPrivate::checkPermissionsBeforeSave()
     return true;
 }
 
-void DocumentManagerPrivate::backupFile(const QString &filePath) const
-{
-    QString backupFilePath = filePath + ".backup";
-    QFile backupFile(backupFilePath);
-
-    if (backupFile.exists()) {
-        if (!backupFile.remove()) {
-            MessageBoxHelper::critical(
-                this->editor,
-                DocumentManager::tr("File backup failed"),
-                backupFile.errorString()
-            );
-            return;
-        }
-    }
-
-    QFile file(filePath);
-
-    if (file.exists()) {
-        if (!file.copy(backupFilePath)) {
-            MessageBoxHelper::critical(
-                this->editor,
-                DocumentManager::tr("File backup failed"),
-                file.errorString()
-            );
-        }
-    }
-}
-
 void DocumentManagerPrivate::autoSaveFile()
 {
     Q_Q(DocumentManager);
@@ -971,14 +1245,101 @@ void DocumentManagerPrivate::autoSaveFile()
     if
     (
         this->autoSaveEnabled &&
+        !this->document->isLoading() &&
         !this->document->isNew() &&
         !this->document->isReadOnly() &&
         this->document->isModified()
     ) {
+        // Rewriting a large file every minute is costly, and the journal
+        // already has the changes, so only make sure they are on disk
+        // until the journal has grown large enough to be worth compacting.
+        //
+        if
+        (
+            journal->isOpen() &&
+            fullSaveTimer.isValid() &&
+            (fullSaveTimer.elapsed() < FULL_SAVE_INTERVAL) &&
+            (journal->size() < qMax(JOURNAL_COMPACT_SIZE, (qint64) document->characterCount()))
+        ) {
+            journal->sync();
+
+            // Come back later to write the file itself.
+            autoSaveTimer->start();
+            return;
+        }
+
         q->save();
     }
 }
 
+void DocumentManagerPrivate::journalEdit
+(
+    int position,
+    int charsRemoved,
+    int charsAdded
+)
+{
+    if (!journal->isOpen() || document->isLoading()) {
+        return;
+    }
+
+    QString insertedText;
+
+    if (charsAdded > 0) {
+        // The change reported for an edit at the end of the document can
+        // include the final paragraph separator, which is not part of the
+        // text.
+        //
+        int end = qMin(position + charsAdded, document->characterCount() - 1);
+
+        QTextCursor cursor(document);
+        cursor.setPosition(position);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+
+        // Convert the text to what toPlainText() would return.
+        insertedText = cursor.selectedText();
+        insertedText.replace(QChar::ParagraphSeparator, '\n');
+        insertedText.replace(QChar::LineSeparator, '\n');
+        insertedText.replace(QChar::Nbsp, ' ');
+    }
+
+    journal->record(position, charsRemoved, insertedText);
+}
+
+void DocumentManagerPrivate::recoverJournal(const QString &filePath)
+{
+    QString fileText = document->plainText();
+    QString recoveredText;
+    bool restore = false;
+
+    if (EditJournal::recover(writer->fileName(), fileText, recoveredText)) {
+        int response =
+            MessageBoxHelper::question
+            (
+                editor,
+                DocumentManager::tr("Unsaved changes to %1 were recovered.")
+                    .arg(filePath),
+                DocumentManager::tr("Would you like to restore them?"),
+                QMessageBox::Yes | QMessageBox::No,
+                QMessageBox::Yes
+            );
+
+        restore = (QMessageBox::Yes == response);
+    }
+
+    // Start journaling from the text in the file, and restore the changes
+    // as an edit, so that they are journaled again, and can be undone.
+    //
+    journal->open(writer->fileName(), fileText);
+
+    if (restore) {
+        QTextCursor cursor(document);
+        cursor.select(QTextCursor::Document);
+        cursor.insertText(recoveredText);
+        document->setModified(true);
+    }
+}
+
 bool DocumentManagerPrivate::documentIsDraft()
 {
     if (document->isNew()) {
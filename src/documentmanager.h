@@ -59,6 +59,11 @@ public:
      */
     bool fileBackupEnabled() const;
 
+    /**
+     * Gets the number of backup files kept when file backup is enabled.
+     */
+    int fileBackupCount() const;
+
     /**
      * Gets whether tracking the recent file history is enabled.
      */
@@ -136,6 +141,12 @@ public slots:
      */
     void setFileBackupEnabled(bool enabled);
 
+    /**
+     * Sets the number of backup files to keep, with older backups having
+     * .backup.2, .backup.3, etc. extensions.
+     */
+    void setFileBackupCount(int count);
+
     /**
      * Sets draft directory location where draft files (i.e., autosaved
      * untitled documents) will be saved.
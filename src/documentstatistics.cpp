@@ -8,6 +8,7 @@
 #include <QTextBoundaryFinder>
 
 #include "documentstatistics.h"
+#include "tracer.h"
 
 namespace ghostwriter
 {
@@ -82,7 +83,7 @@ DocumentStatistics::DocumentStatistics(MarkdownDocument *document, QObject *pare
     d->lixLongWordCount = 0;
     d->readTimeMinutes = 0;
 
-    connect(d->document, SIGNAL(contentsChange(int, int, int)), this, SLOT(onTextChanged(int, int, int)));
+    connect(d->document, SIGNAL(contentsRevised()), this, SLOT(onTextChanged()));
     connect(d->document,
         &MarkdownDocument::cleared,
         [d]() {
@@ -201,13 +202,11 @@ void DocumentStatistics::onTextDeselected()
     d->updateStatistics();
 }
 
-void DocumentStatistics::onTextChanged(int position, int charsRemoved, int charsAdded)
+void DocumentStatistics::onTextChanged()
 {
-    Q_D(DocumentStatistics);
+    TraceScope trace("DocumentStatistics::onTextChanged");
 
-    Q_UNUSED(position)
-    Q_UNUSED(charsRemoved)
-    Q_UNUSED(charsAdded)
+    Q_D(DocumentStatistics);
 
     d->wordCount = 0;
     d->wordCharacterCount = 0;
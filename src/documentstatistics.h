@@ -122,7 +122,7 @@ public slots:
 
 
 protected slots:
-    void onTextChanged(int position, int charsRemoved, int charsAdded);
+    void onTextChanged();
 
 private:
     QScopedPointer<DocumentStatisticsPrivate> d_ptr;
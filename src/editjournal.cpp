@@ -0,0 +1,491 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFuture>
+#include <QList>
+#include <QMap>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtConcurrentRun>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "editjournal.h"
+
+namespace ghostwriter
+{
+/*
+* Hash of the text to be written to the file at a checkpoint, and the
+* number of records in the journal at the time.
+*/
+struct EditJournalCheckpoint
+{
+    QByteArray hash;
+    int recordCount;
+};
+
+class EditJournalPrivate
+{
+    Q_DECLARE_PUBLIC(EditJournal)
+
+public:
+    static const quint32 MAGIC = 0x474A524E;
+    static const quint32 VERSION = 1;
+
+    /*
+    * Time to wait after an edit before writing the journal to disk, so
+    * that the records of a burst of typing are written together.
+    */
+    static const int SYNC_INTERVAL = 2000;
+
+    EditJournalPrivate(EditJournal *q_ptr)
+        : q_ptr(q_ptr),
+          size(0)
+    {
+        ;
+    }
+
+    ~EditJournalPrivate()
+    {
+        ;
+    }
+
+    EditJournal *q_ptr;
+
+    QString filePath;
+    QFile file;
+    QByteArray baseHash;
+    qint64 size;
+
+    // Encoded records in the journal file, in order, so that they can be
+    // rewritten when compacting the journal.
+    //
+    QList<QByteArray> records;
+    QMap<int, EditJournalCheckpoint> checkpoints;
+
+    QTimer *syncTimer;
+
+    // Synchronizes the journal file to disk on a worker thread.
+    QFuture<void> syncFuture;
+
+    static QByteArray hash(const QString &text);
+    static QByteArray encodeHeader(const QByteArray &hash);
+    static QByteArray encodeRecord
+    (
+        int position,
+        int charsRemoved,
+        const QString &insertedText
+    );
+    static quint16 checksum(const QByteArray &data);
+
+    /*
+    * Rewrites the journal file with the base hash and records.  Returns
+    * true if successful.
+    */
+    bool rewrite();
+
+    /*
+    * Waits for the last synchronization to finish, which must be done
+    * before closing the file.
+    */
+    void waitForSync();
+};
+
+EditJournal::EditJournal(QObject *parent)
+    : QObject(parent),
+      d_ptr(new EditJournalPrivate(this))
+{
+    Q_D(EditJournal);
+
+    d->syncTimer = new QTimer(this);
+    d->syncTimer->setSingleShot(true);
+    d->syncTimer->setInterval(EditJournalPrivate::SYNC_INTERVAL);
+
+    this->connect
+    (
+        d->syncTimer,
+        &QTimer::timeout,
+        this,
+        &EditJournal::sync
+    );
+}
+
+EditJournal::~EditJournal()
+{
+    close(false);
+}
+
+QString EditJournal::journalFilePath(const QString &filePath)
+{
+    return filePath + ".journal";
+}
+
+bool EditJournal::recover
+(
+    const QString &filePath,
+    const QString &fileText,
+    QString &recoveredText
+)
+{
+    QFile file(journalFilePath(filePath));
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray baseHash;
+
+    in >> magic >> version >> baseHash;
+
+    if ((QDataStream::Ok != in.status())
+            || (EditJournalPrivate::MAGIC != magic)
+            || (EditJournalPrivate::VERSION != version)
+            || (EditJournalPrivate::hash(fileText) != baseHash)) {
+        return false;
+    }
+
+    QString text = fileText;
+
+    // Replay records until the end of the journal, or until a record that
+    // was only partially written when the application crashed.
+    //
+    while (!in.atEnd()) {
+        QByteArray payload;
+        quint16 checksum = 0;
+
+        in >> payload >> checksum;
+
+        if ((QDataStream::Ok != in.status())
+                || (EditJournalPrivate::checksum(payload) != checksum)) {
+            break;
+        }
+
+        QDataStream record(payload);
+        record.setVersion(QDataStream::Qt_5_15);
+
+        qint32 position = 0;
+        qint32 charsRemoved = 0;
+        QByteArray insertedText;
+
+        record >> position >> charsRemoved >> insertedText;
+
+        if ((QDataStream::Ok != record.status())
+                || (position < 0)
+                || (position > text.length())
+                || (charsRemoved < 0)) {
+            break;
+        }
+
+        text.replace(position, charsRemoved, QString::fromUtf8(insertedText));
+    }
+
+    if (text == fileText) {
+        return false;
+    }
+
+    recoveredText = text;
+    return true;
+}
+
+void EditJournal::remove(const QString &filePath)
+{
+    QFile::remove(journalFilePath(filePath));
+}
+
+bool EditJournal::open(const QString &filePath, const QString &baseText)
+{
+    Q_D(EditJournal);
+
+    close(false);
+
+    d->filePath = filePath;
+    d->baseHash = EditJournalPrivate::hash(baseText);
+    d->file.setFileName(journalFilePath(filePath));
+
+    if (!d->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        d->filePath = QString();
+        return false;
+    }
+
+    QByteArray header = EditJournalPrivate::encodeHeader(d->baseHash);
+
+    d->file.write(header);
+    d->size = header.size();
+    sync();
+
+    return true;
+}
+
+void EditJournal::close(bool remove)
+{
+    Q_D(EditJournal);
+
+    d->syncTimer->stop();
+
+    if (d->file.isOpen()) {
+        if (!remove) {
+            // Make sure the last records get synchronized, rather than
+            // skipped because an earlier synchronization is running.
+            //
+            d->waitForSync();
+            sync();
+        }
+
+        d->waitForSync();
+        d->file.close();
+
+        if (remove) {
+            d->file.remove();
+        }
+    }
+
+    d->filePath = QString();
+    d->baseHash.clear();
+    d->records.clear();
+    d->checkpoints.clear();
+    d->size = 0;
+}
+
+bool EditJournal::isOpen() const
+{
+    Q_D(const EditJournal);
+
+    return d->file.isOpen();
+}
+
+QString EditJournal::filePath() const
+{
+    Q_D(const EditJournal);
+
+    return d->filePath;
+}
+
+qint64 EditJournal::size() const
+{
+    Q_D(const EditJournal);
+
+    return d->size;
+}
+
+void EditJournal::record
+(
+    int position,
+    int charsRemoved,
+    const QString &insertedText
+)
+{
+    Q_D(EditJournal);
+
+    if (!d->file.isOpen()) {
+        return;
+    }
+
+    QByteArray record =
+        EditJournalPrivate::encodeRecord(position, charsRemoved, insertedText);
+
+    // The record is buffered by the file until the next synchronization.
+    d->records.append(record);
+    d->file.write(record);
+    d->size += record.size();
+
+    if (!d->syncTimer->isActive()) {
+        d->syncTimer->start();
+    }
+}
+
+void EditJournal::checkpoint(int revision, const QString &text)
+{
+    Q_D(EditJournal);
+
+    if (!d->file.isOpen()) {
+        return;
+    }
+
+    EditJournalCheckpoint checkpoint;
+    checkpoint.hash = EditJournalPrivate::hash(text);
+    checkpoint.recordCount = d->records.size();
+
+    d->checkpoints.insert(revision, checkpoint);
+}
+
+void EditJournal::commit(int revision)
+{
+    Q_D(EditJournal);
+
+    if (!d->checkpoints.contains(revision)) {
+        return;
+    }
+
+    EditJournalCheckpoint checkpoint = d->checkpoints.take(revision);
+
+    // Earlier checkpoints will never be written, since their text is
+    // older than what is now in the file.
+    //
+    while (!d->checkpoints.isEmpty() && (d->checkpoints.firstKey() < revision)) {
+        d->checkpoints.erase(d->checkpoints.begin());
+    }
+
+    for (EditJournalCheckpoint &later : d->checkpoints) {
+        later.recordCount -= checkpoint.recordCount;
+    }
+
+    d->records = d->records.mid(checkpoint.recordCount);
+    d->baseHash = checkpoint.hash;
+
+    // If compacting fails, the old journal is still consistent with the
+    // file, since it holds the edits made since the previous checkpoint
+    // followed by those made since this one.
+    //
+    d->rewrite();
+}
+
+void EditJournal::discard(int revision)
+{
+    Q_D(EditJournal);
+
+    d->checkpoints.remove(revision);
+}
+
+void EditJournal::sync()
+{
+    Q_D(EditJournal);
+
+    d->syncTimer->stop();
+
+    if (!d->file.isOpen()) {
+        return;
+    }
+
+    d->file.flush();
+
+    // Don't hold up typing while the disk catches up with the last
+    // synchronization.  Try again later instead.
+    //
+    if (d->syncFuture.isRunning()) {
+        d->syncTimer->start();
+        return;
+    }
+
+    int handle = d->file.handle();
+
+    d->syncFuture = QtConcurrent::run([handle]() {
+#ifdef Q_OS_WIN
+        ::_commit(handle);
+#else
+        ::fsync(handle);
+#endif
+    });
+}
+
+QByteArray EditJournalPrivate::hash(const QString &text)
+{
+    return QCryptographicHash::hash
+        (
+            QByteArray::fromRawData
+            (
+                reinterpret_cast<const char *>(text.constData()),
+                text.length() * sizeof(QChar)
+            ),
+            QCryptographicHash::Sha1
+        );
+}
+
+QByteArray EditJournalPrivate::encodeHeader(const QByteArray &hash)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+
+    out << MAGIC << VERSION << hash;
+    return header;
+}
+
+QByteArray EditJournalPrivate::encodeRecord
+(
+    int position,
+    int charsRemoved,
+    const QString &insertedText
+)
+{
+    QByteArray payload;
+    QDataStream payloadOut(&payload, QIODevice::WriteOnly);
+    payloadOut.setVersion(QDataStream::Qt_5_15);
+
+    payloadOut << qint32(position) << qint32(charsRemoved) << insertedText.toUtf8();
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+
+    out << payload << checksum(payload);
+    return record;
+}
+
+quint16 EditJournalPrivate::checksum(const QByteArray &data)
+{
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    return qChecksum(data.constData(), data.size());
+#else
+    return qChecksum(QByteArrayView(data));
+#endif
+}
+
+bool EditJournalPrivate::rewrite()
+{
+    waitForSync();
+
+    QSaveFile journal(file.fileName());
+
+    if (!journal.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QByteArray header = encodeHeader(baseHash);
+    qint64 newSize = header.size();
+
+    journal.write(header);
+
+    for (const QByteArray &record : records) {
+        journal.write(record);
+        newSize += record.size();
+    }
+
+    if (!journal.commit()) {
+        return false;
+    }
+
+    // Switch over to appending to the new file.
+    file.close();
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        filePath = QString();
+        return false;
+    }
+
+    size = newSize;
+    return true;
+}
+
+void EditJournalPrivate::waitForSync()
+{
+    if (syncFuture.isRunning() || syncFuture.isStarted()) {
+        syncFuture.waitForFinished();
+    }
+}
+} // namespace ghostwriter
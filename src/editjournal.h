@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+namespace ghostwriter
+{
+/**
+ * Append-only journal of the edits made to a document since it was last
+ * saved, kept in a sidecar file next to the document's file (with a
+ * ".journal" extension), so that unsaved changes can be recovered after
+ * a crash.  Each edit is recorded as the position at which it was made,
+ * the number of characters removed, and the UTF-8 text inserted, so the
+ * amount of data written grows with the amount of typing rather than
+ * with the size of the document.  Records are buffered, and written and
+ * synchronized to disk in batches.
+ *
+ * The journal starts from a base text, whose hash is stored in the
+ * journal's header.  Edits can only be replayed on top of a file whose
+ * text matches that hash.  When the document is saved, call checkpoint()
+ * with the text being written, and commit() once the write is complete
+ * to compact the journal down to the edits made since.
+ */
+class EditJournalPrivate;
+class EditJournal : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(EditJournal)
+
+public:
+    /**
+     * Constructor.
+     */
+    EditJournal(QObject *parent = nullptr);
+
+    /**
+     * Destructor.  Closes the journal without removing it.
+     */
+    virtual ~EditJournal();
+
+    /**
+     * Returns the path of the journal for the file at the given path.
+     */
+    static QString journalFilePath(const QString &filePath);
+
+    /**
+     * Replays the journal of the file at the given path on top of the
+     * file's text.  Returns true and sets recoveredText if the journal
+     * exists, matches the file's text, and contains edits that change
+     * it.  Returns false otherwise, in which case the journal is of no
+     * use and can be removed.
+     */
+    static bool recover
+    (
+        const QString &filePath,
+        const QString &fileText,
+        QString &recoveredText
+    );
+
+    /**
+     * Removes the journal of the file at the given path, if any.
+     */
+    static void remove(const QString &filePath);
+
+    /**
+     * Starts a new journal for the file at the given path, replacing any
+     * existing one, for edits made on top of the given base text.
+     * Returns false if the journal file could not be created.
+     */
+    bool open(const QString &filePath, const QString &baseText);
+
+    /**
+     * Closes the journal, first synchronizing it to disk.  If remove is
+     * true, the journal file is deleted, as its edits are either saved
+     * or unwanted.
+     */
+    void close(bool remove);
+
+    /**
+     * Returns true if the journal is open.
+     */
+    bool isOpen() const;
+
+    /**
+     * Returns the path of the file whose edits are being journaled.
+     */
+    QString filePath() const;
+
+    /**
+     * Returns the size of the journal, in bytes.
+     */
+    qint64 size() const;
+
+    /**
+     * Records an edit that removed the given number of characters at the
+     * given position and inserted the given text in their place.
+     */
+    void record(int position, int charsRemoved, const QString &insertedText);
+
+    /**
+     * Notes that the given text is about to be written to the file as
+     * the given revision (as returned by AsyncTextWriter::lastRevision()).
+     */
+    void checkpoint(int revision, const QString &text);
+
+    /**
+     * Compacts the journal once the text of the given checkpoint revision
+     * has been written to the file, dropping the edits it contains.
+     */
+    void commit(int revision);
+
+    /**
+     * Forgets the given checkpoint revision, because its text was never
+     * written to the file.
+     */
+    void discard(int revision);
+
+public slots:
+    /**
+     * Writes buffered records to the journal file and synchronizes it to
+     * disk.  If the previous synchronization is still running, the new
+     * one is retried later rather than waited for.
+     */
+    void sync();
+
+private:
+    QScopedPointer<EditJournalPrivate> d_ptr;
+};
+} // namespace ghostwriter
+
+#endif // EDITJOURNAL_H
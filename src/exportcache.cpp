@@ -0,0 +1,419 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "exportcache.h"
+
+namespace ghostwriter
+{
+/*
+* Size and last use of a file in the cache.
+*/
+struct ExportCacheEntry
+{
+    qint64 size;
+    QDateTime lastUsed;
+};
+
+class ExportCachePrivate
+{
+public:
+    static ExportCache *instance;
+
+    ExportCachePrivate()
+        : enabled(false),
+          maxSize(ExportCache::DEFAULT_MAX_SIZE_MB * 1024LL * 1024LL),
+          size(0),
+          loaded(false),
+          hitCount(0),
+          missCount(0)
+    {
+        ;
+    }
+
+    ~ExportCachePrivate()
+    {
+        ;
+    }
+
+    // Guards all of the below.
+    mutable QMutex mutex;
+
+    bool enabled;
+    qint64 maxSize;
+    qint64 size;
+    QString dirPath;
+    QHash<QString, ExportCacheEntry> entries;
+    bool loaded;
+    int hitCount;
+    int missCount;
+
+    /*
+    * Reads the entries that are already in the cache directory, if this
+    * has not been done yet.
+    */
+    void load();
+
+    /*
+    * Removes the least recently used entries until the cache fits
+    * within its maximum size.
+    */
+    void evict();
+
+    /*
+    * Copies a file, replacing the destination only once the copy is
+    * complete.  The copy is a reflink where supported.
+    */
+    static bool copyFile(const QString &sourcePath, const QString &destinationPath);
+};
+
+ExportCache *ExportCachePrivate::instance = nullptr;
+
+ExportCache *ExportCache::instance()
+{
+    if (nullptr == ExportCachePrivate::instance) {
+        ExportCachePrivate::instance = new ExportCache();
+    }
+
+    return ExportCachePrivate::instance;
+}
+
+ExportCache::~ExportCache()
+{
+    ;
+}
+
+QByteArray ExportCache::key
+(
+    const Exporter *exporter,
+    const ExportFormat *format,
+    const QString &inputFilePath,
+    const QString &text,
+    bool smartTypographyEnabled
+)
+{
+    QString baseDir;
+
+    if (!inputFilePath.isEmpty()) {
+        baseDir = QFileInfo(inputFilePath).absolutePath();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    // Separate the fields with a null character so that different
+    // combinations of them never produce the same input to the hash.
+    //
+    hash.addData(exporter->name().toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(exporter->version().toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(format->name().toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(smartTypographyEnabled ? "1" : "0", 1);
+    hash.addData("\0", 1);
+    hash.addData(baseDir.toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(text.toUtf8());
+
+    return hash.result().toHex();
+}
+
+bool ExportCache::isEnabled() const
+{
+    Q_D(const ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    return d->enabled;
+}
+
+void ExportCache::setEnabled(bool enabled)
+{
+    Q_D(ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    d->enabled = enabled;
+}
+
+int ExportCache::maxSize() const
+{
+    Q_D(const ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    return d->maxSize / (1024 * 1024);
+}
+
+void ExportCache::setMaxSize(int megabytes)
+{
+    Q_D(ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    d->maxSize = qMax(1, megabytes) * 1024LL * 1024LL;
+
+    if (d->loaded) {
+        d->evict();
+    }
+}
+
+bool ExportCache::fetch(const QByteArray &key, const QString &outputFilePath)
+{
+    Q_D(ExportCache);
+
+    QString name = QString::fromLatin1(key);
+    QString cachedFilePath;
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (!d->enabled) {
+            return false;
+        }
+
+        d->load();
+
+        if (!d->entries.contains(name)) {
+            d->missCount++;
+            return false;
+        }
+
+        cachedFilePath = QDir(d->dirPath).filePath(name);
+    }
+
+    // Copy outside of the lock so that other threads are not held up.
+    bool copied = ExportCachePrivate::copyFile(cachedFilePath, outputFilePath);
+
+    QMutexLocker locker(&d->mutex);
+
+    if (!copied) {
+        d->missCount++;
+        return false;
+    }
+
+    d->hitCount++;
+
+    // Mark the entry as recently used, also on disk so that the order
+    // survives restarts.
+    //
+    if (d->entries.contains(name)) {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        d->entries[name].lastUsed = now;
+
+        QFile cachedFile(cachedFilePath);
+
+        if (cachedFile.open(QFile::ReadWrite)) {
+            cachedFile.setFileTime(now, QFileDevice::FileModificationTime);
+        }
+    }
+
+    return true;
+}
+
+void ExportCache::store(const QByteArray &key, const QString &outputFilePath)
+{
+    Q_D(ExportCache);
+
+    QString name = QString::fromLatin1(key);
+    QString cachedFilePath;
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (!d->enabled) {
+            return;
+        }
+
+        d->load();
+
+        if (d->dirPath.isEmpty() || !QDir().mkpath(d->dirPath)) {
+            return;
+        }
+
+        cachedFilePath = QDir(d->dirPath).filePath(name);
+    }
+
+    if (!ExportCachePrivate::copyFile(outputFilePath, cachedFilePath)) {
+        return;
+    }
+
+    ExportCacheEntry entry;
+    entry.size = QFileInfo(cachedFilePath).size();
+    entry.lastUsed = QDateTime::currentDateTimeUtc();
+
+    QMutexLocker locker(&d->mutex);
+
+    if (d->entries.contains(name)) {
+        d->size -= d->entries.value(name).size;
+    }
+
+    d->entries.insert(name, entry);
+    d->size += entry.size;
+    d->evict();
+}
+
+void ExportCache::clear()
+{
+    Q_D(ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->load();
+
+    QDir dir(d->dirPath);
+
+    for (const QString &name : d->entries.keys()) {
+        dir.remove(name);
+    }
+
+    d->entries.clear();
+    d->size = 0;
+}
+
+int ExportCache::hitCount() const
+{
+    Q_D(const ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    return d->hitCount;
+}
+
+int ExportCache::missCount() const
+{
+    Q_D(const ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    return d->missCount;
+}
+
+qint64 ExportCache::size() const
+{
+    Q_D(const ExportCache);
+
+    QMutexLocker locker(&d->mutex);
+    const_cast<ExportCachePrivate *>(d)->load();
+    return d->size;
+}
+
+ExportCache::ExportCache()
+    : d_ptr(new ExportCachePrivate())
+{
+    ;
+}
+
+void ExportCachePrivate::load()
+{
+    if (loaded) {
+        return;
+    }
+
+    loaded = true;
+
+    QString cacheLocation =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+    if (cacheLocation.isEmpty()) {
+        return;
+    }
+
+    dirPath = QDir(cacheLocation).filePath("exports");
+
+    const QFileInfoList files = QDir(dirPath).entryInfoList(QDir::Files);
+
+    for (const QFileInfo &fileInfo : files) {
+        ExportCacheEntry entry;
+        entry.size = fileInfo.size();
+        entry.lastUsed = fileInfo.lastModified().toUTC();
+
+        entries.insert(fileInfo.fileName(), entry);
+        size += entry.size;
+    }
+
+    evict();
+}
+
+void ExportCachePrivate::evict()
+{
+    if (size <= maxSize) {
+        return;
+    }
+
+    QList<QString> names = entries.keys();
+
+    std::sort
+    (
+        names.begin(),
+        names.end(),
+        [this](const QString &a, const QString &b) {
+            return entries.value(a).lastUsed < entries.value(b).lastUsed;
+        }
+    );
+
+    QDir dir(dirPath);
+
+    for (const QString &name : names) {
+        if (size <= maxSize) {
+            break;
+        }
+
+        dir.remove(name);
+        size -= entries.take(name).size;
+    }
+}
+
+bool ExportCachePrivate::copyFile
+(
+    const QString &sourcePath,
+    const QString &destinationPath
+)
+{
+    QFile source(sourcePath);
+
+    if (!source.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QSaveFile destination(destinationPath);
+
+    if (!destination.open(QFile::WriteOnly)) {
+        return false;
+    }
+
+    bool cloned = false;
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    cloned = (0 == ::ioctl(destination.handle(), FICLONE, source.handle()));
+#endif
+
+    if (!cloned) {
+        while (!source.atEnd()) {
+            QByteArray chunk = source.read(64 * 1024);
+
+            if (chunk.isEmpty() || (destination.write(chunk) != chunk.size())) {
+                destination.cancelWriting();
+                return false;
+            }
+        }
+    }
+
+    return destination.commit();
+}
+} // namespace ghostwriter
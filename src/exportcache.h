@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef EXPORTCACHE_H
+#define EXPORTCACHE_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+
+#include "exporter.h"
+#include "exportformat.h"
+
+namespace ghostwriter
+{
+/**
+ * On-disk cache of exported files, so that exporting an unchanged
+ * document again with the same settings copies the previous result
+ * instead of running the conversion again.  Entries are addressed by a
+ * hash of everything that determines the output, and the least recently
+ * used entries are evicted once the cache exceeds its maximum size.
+ * Where the file system supports it, files are copied into and out of
+ * the cache as reflinks, which share the data on disk.
+ *
+ * The cache is disabled by default.  All methods are thread-safe.
+ */
+class ExportCachePrivate;
+class ExportCache
+{
+    Q_DECLARE_PRIVATE(ExportCache)
+
+public:
+    /**
+     * Default maximum size of the cache, in megabytes.
+     */
+    static const int DEFAULT_MAX_SIZE_MB = 256;
+
+    /**
+     * Gets the singleton instance of this class.
+     */
+    static ExportCache *instance();
+
+    /**
+     * Destructor.
+     */
+    ~ExportCache();
+
+    /**
+     * Returns the key of the cache entry for exporting the given text
+     * with the given exporter and settings.  The key covers the text,
+     * the exporter's name and version, the format, the smart typography
+     * setting, and the directory of the input file, against which
+     * processors resolve relative paths to images and other resources.
+     */
+    static QByteArray key
+    (
+        const Exporter *exporter,
+        const ExportFormat *format,
+        const QString &inputFilePath,
+        const QString &text,
+        bool smartTypographyEnabled
+    );
+
+    /**
+     * Returns true if the cache is enabled.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Enables or disables the cache.  While disabled, lookups always
+     * miss without being counted, and nothing is stored.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Returns the maximum size of the cache, in megabytes.
+     */
+    int maxSize() const;
+
+    /**
+     * Sets the maximum size of the cache, in megabytes, evicting entries
+     * if the cache is now too large.
+     */
+    void setMaxSize(int megabytes);
+
+    /**
+     * Copies the cached file for the given key to outputFilePath.
+     * Returns true on a cache hit, or false on a miss, in which case
+     * the output file is left untouched.
+     */
+    bool fetch(const QByteArray &key, const QString &outputFilePath);
+
+    /**
+     * Stores a copy of the exported file at outputFilePath under the
+     * given key.
+     */
+    void store(const QByteArray &key, const QString &outputFilePath);
+
+    /**
+     * Removes all entries from the cache.
+     */
+    void clear();
+
+    /**
+     * Returns the number of cache hits since the application started.
+     */
+    int hitCount() const;
+
+    /**
+     * Returns the number of cache misses since the application started.
+     */
+    int missCount() const;
+
+    /**
+     * Returns the current size of the cache, in bytes.
+     */
+    qint64 size() const;
+
+private:
+    QScopedPointer<ExportCachePrivate> d_ptr;
+
+    ExportCache();
+};
+} // namespace ghostwriter
+
+#endif // EXPORTCACHE_H
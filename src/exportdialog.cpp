@@ -4,10 +4,8 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
-#include <QApplication>
 #include <QCheckBox>
 #include <QComboBox>
-#include <QDesktopServices>
 #include <QDialogButtonBox>
 #include <QFileDialog>
 #include <QFileInfo>
@@ -19,13 +17,12 @@
 #include <QSettings>
 #include <QStandardPaths>
 #include <QString>
-#include <QUrl>
 #include <QVBoxLayout>
 
 #include "exportdialog.h"
 #include "exporter.h"
 #include "exporterfactory.h"
-#include "messageboxhelper.h"
+#include "exportjobqueue.h"
 
 #define GW_LAST_EXPORTER_KEY "Export/lastUsedExporter"
 #define GW_SMART_TYPOGRAPHY_KEY "Export/smartTypographyEnabled"
@@ -155,29 +152,17 @@ void ExportDialog::accept()
     }
 
     QString fileName = fileDialog.selectedFiles().at(0);
-    QString err;
 
-    QApplication::setOverrideCursor(Qt::WaitCursor);
-    emit exportStarted(tr("exporting to %1").arg(fileName));
-
-    exporter->setSmartTypographyEnabled(smartTypographyCheckBox->isChecked());
-    exporter->exportToFile
+    // Export in the background so that the user can keep editing.
+    ExportJobQueue::instance()->addJob
     (
+        exporter,
         format,
         this->document->filePath(),
-        document->toPlainText(),
+        document->plainText(),
         fileName,
-        err
-    );    
-    
-    emit exportComplete();
-    QApplication::restoreOverrideCursor();
-
-    if (!err.isNull()) {
-        MessageBoxHelper::critical(this, tr("Export failed."), err);
-    } else {
-        QDesktopServices::openUrl(QUrl::fromLocalFile(fileName));
-    }
+        smartTypographyCheckBox->isChecked()
+    );
 
     QDialog::accept();
 }
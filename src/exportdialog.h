@@ -22,7 +22,8 @@ namespace ghostwriter
  * logic is performed by Exporters, which are provided by ExporterFactory.  The
  * user can select which exporter to use in a combo box.  Also, an option for
  * enabling/disabling smart typography during export is provided in the form of
- * a checkbox.
+ * a checkbox.  Exports are added to the ExportJobQueue, which reports their
+ * progress and results.
  */
 class ExportDialog : public QDialog
 {
@@ -36,22 +37,6 @@ public:
     ExportDialog(MarkdownDocument *document, QWidget *parent = nullptr);
     virtual ~ExportDialog();
 
-signals:
-    /**
-     * Emitted when an export operation has begun, so that some sort of
-     * notification can be provided to the user by the calling program,
-     * such as displaying a progress bar.
-     */
-    void exportStarted(const QString &description);
-
-    /**
-     * Emitted when an export operation has completed, so that some sort of
-     * notification can be provided to the user by the calling program,
-     * such as removing a progress bar previously shown when the export
-     * operation began.
-     */
-    void exportComplete();
-
 private slots:
     /*
     * Called when the user clicks on Export button.
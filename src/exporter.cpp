@@ -34,6 +34,16 @@ QString Exporter::name() const
     return m_name;
 }
 
+QString Exporter::version() const
+{
+    return m_version;
+}
+
+void Exporter::setVersion(const QString &version)
+{
+    m_version = version;
+}
+
 const QList<const ExportFormat *> Exporter::supportedFormats() const
 {
     return m_supportedFormats;
@@ -55,8 +65,41 @@ bool Exporter::supportsMath() const
 }
 
 void Exporter::exportToHtml(const QString &text, QString &html)
+{
+    exportToHtml(text, m_smartTypographyEnabled, false, html);
+}
+
+void Exporter::exportToFile
+(
+    const ExportFormat *format,
+    const QString &inputFilePath,
+    const QString &text,
+    const QString &outputFilePath,
+    QString &err
+)
+{
+    exportToFile
+    (
+        format,
+        inputFilePath,
+        text,
+        outputFilePath,
+        m_smartTypographyEnabled,
+        err
+    );
+}
+
+void Exporter::exportToHtml
+(
+    const QString &text,
+    const bool smartTypographyEnabled,
+    const bool sourcePositionsEnabled,
+    QString &html
+)
 {
     Q_UNUSED(text)
+    Q_UNUSED(smartTypographyEnabled)
+    Q_UNUSED(sourcePositionsEnabled)
 
     html = QString("<center><b style='color: red'>") +
            QObject::tr("Export to HTML is not supported with this processor.") +
@@ -45,6 +45,17 @@ public:
      */
     void setName(const QString &name);
 
+    /**
+     * Gets the version of the underlying processor, or an empty string
+     * if it is unknown.
+     */
+    QString version() const;
+
+    /**
+     * Sets the version of the underlying processor.
+     */
+    void setVersion(const QString &version);
+
     /**
      * Returns the supported formats to which this exporter can export.
      * This method will return the value of the protected field
@@ -70,13 +81,46 @@ public:
      */
     bool supportsMath() const;
 
+    /**
+     * Transforms the given text into HTML, using this exporter's smart
+     * typography setting.
+     */
+    void exportToHtml(const QString &text, QString &html);
+
     /**
      * Override this method to transform the given text into HTML for
-     * use in the Live HTML Preview.  By default, this method will set the
-     * html parameter to have HTML-formatted error text indicating that HTML
-     * is not supported by the export processor.
+     * use in the Live HTML Preview.  The options are passed in rather
+     * than read from this exporter's settings so that the preview can
+     * render on a worker thread without changing them.  Pass in true for
+     * sourcePositionsEnabled to annotate HTML block elements with a
+     * data-sourcepos attribute (i.e., "3:1-5:12") indicating the range of
+     * Markdown source lines and columns from which each element was
+     * rendered, which the live preview uses to keep its scroll position
+     * synchronized with the editor.  Like smart typography, support for
+     * source positions is optional.  By default, this method will set the
+     * html parameter to have HTML-formatted error text indicating that
+     * HTML is not supported by the export processor.
+     */
+    virtual void exportToHtml
+    (
+        const QString &text,
+        const bool smartTypographyEnabled,
+        const bool sourcePositionsEnabled,
+        QString &html
+    );
+
+    /**
+     * Exports the given text to a file of the given format, using this
+     * exporter's smart typography setting.
      */
-    virtual void exportToHtml(const QString &text, QString &html);
+    void exportToFile
+    (
+        const ExportFormat *format,
+        const QString &inputFilePath,
+        const QString &text,
+        const QString &outputFilePath,
+        QString &err
+    );
 
     /**
      * Implement this method to export the given text to a file of the
@@ -87,7 +131,10 @@ public:
      * success, in case the method's caller accidentally passed in
      * a non-null, non-empty QString value.  If there is no input
      * file path due to the document being new and untitled, then
-     * specify a null or empty inputFilePath value.
+     * specify a null or empty inputFilePath value.  The smart
+     * typography option is passed in rather than read from this
+     * exporter's settings so that exports can run on worker threads
+     * without changing them.
      */
     virtual void exportToFile
     (
@@ -95,6 +142,7 @@ public:
         const QString &inputFilePath,
         const QString &text,
         const QString &outputFilePath,
+        const bool smartTypographyEnabled,
         QString &err
     ) = 0;
 
@@ -122,6 +170,7 @@ protected:
 
 private:
     QString m_name;
+    QString m_version;
 };
 } // namespace ghostwriter
 
@@ -4,23 +4,34 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <QDateTime>
 #include <QDebug>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QProcess>
 #include <QRegularExpression>
 #include <QSettings>
+#include <QStandardPaths>
 #include <QVersionNumber> 
+#include <QtConcurrentRun>
 
 #include "exporterfactory.h"
 #include "cmarkgfmexporter.h"
 #include "commandlineexporter.h"
 
+#define GW_CONVERTER_CACHE_GROUP "ConverterVersions"
+
 namespace ghostwriter
 {
 
 class ExporterFactoryPrivate
 {
+    Q_DECLARE_PUBLIC(ExporterFactory)
+
 public:
-    ExporterFactoryPrivate()
+    ExporterFactoryPrivate(ExporterFactory *q_ptr)
+        : q_ptr(q_ptr)
     {
         ;
     }
@@ -31,20 +42,66 @@ public:
     }
 
     static ExporterFactory *instance;
+    ExporterFactory *q_ptr;
     QList<Exporter *> fileExporters;
     QList<Exporter *> htmlExporters;
 
+    // External processors to detect, and the paths at which
+    // their executables were found.
+    //
+    const QStringList commands = { "pandoc", "multimarkdown", "cmark" };
+    QHash<QString, QString> commandPaths;
+
+    // Versions of the processors by executable path, including those
+    // loaded from the cache while detection of the others is pending.
+    //
+    QHash<QString, QVersionNumber> detectedVersions;
+    QFutureWatcher<QHash<QString, QVersionNumber>> *detectionWatcher;
+    bool detectionPending;
+
+    /*
+    * Executes each of the given executables with the --version option
+    * in parallel to see if they are installed and runnable.  Returns
+    * the version numbers by executable path, with a null version number
+    * for executables that failed.  Runs on a worker thread.
+    */
+    static QHash<QString, QVersionNumber> detectVersions(const QStringList &paths);
+
+    /*
+    * Extracts the version number from the --version output of a
+    * processor.
+    */
+    static QVersionNumber parseVersion(const QString &output);
+
     /*
-    * Executes the given terminal command to see if the executable is
-    * installed and available.  An example of a test command would be:
-    *
-    *      <process_name> --version
-    *
-    * Returns the version number if the command is available, or else
-    * a null version number.
+    * Looks up the version of the command cached in the settings.
+    * Returns false if there is no cached version, or if the executable
+    * has been replaced or modified since it was cached.
     */
-    QVersionNumber isCommandAvailable(const QString &command,
-        const QStringList &args) const;
+    bool cachedVersion
+    (
+        const QString &command,
+        const QString &path,
+        QVersionNumber &version
+    ) const;
+
+    /*
+    * Stores the detected version of the command in the settings.
+    */
+    void cacheVersion
+    (
+        const QString &command,
+        const QString &path,
+        const QVersionNumber &version
+    ) const;
+
+    /*
+    * Registers the exporters for the external processors having
+    * the given versions, keyed by executable path.
+    */
+    void addConverterExporters(const QHash<QString, QVersionNumber> &versions);
+
+    void onDetectionFinished(const QHash<QString, QVersionNumber> &versions);
 
     /*
     * Convenience method to create a Pandoc exporter with the given name
@@ -59,8 +116,7 @@ public:
     (
         const QString &name,
         const QString &inputFormat,
-        int majorVersion,
-        int minorVersion
+        const QVersionNumber &version
     );
 };
 
@@ -124,36 +180,178 @@ Exporter *ExporterFactory::exporterByName(const QString &name)
 }
 
 ExporterFactory::ExporterFactory()
-    : d_ptr(new ExporterFactoryPrivate())
+    : d_ptr(new ExporterFactoryPrivate(this))
 {
     Q_D(ExporterFactory);
     
-    CommandLineExporter *exporter = nullptr;
-    QVersionNumber pandocVersion = d->isCommandAvailable("pandoc", QStringList("--version"));
-    QVersionNumber mmdVersion = d->isCommandAvailable("multimarkdown", QStringList("--version"));
-    QVersionNumber cmarkVersion = d->isCommandAvailable("cmark", QStringList("--version"));
-
+    // The built-in processor is always available.
     CmarkGfmExporter *cmarkGfmExporter = new CmarkGfmExporter();
     d->fileExporters.append(cmarkGfmExporter);
     d->htmlExporters.append(cmarkGfmExporter);
 
+    d->detectionPending = false;
+    d->detectionWatcher = new QFutureWatcher<QHash<QString, QVersionNumber>>(this);
+
+    this->connect(
+        d->detectionWatcher,
+        &QFutureWatcher<QHash<QString, QVersionNumber>>::finished,
+        [d]() {
+            d->onDetectionFinished(d->detectionWatcher->result());
+        }
+    );
+
+    // Look up the versions of the external processors from the cache.
+    // Only executables that were installed or updated since the last
+    // time they were detected need to be run, and those are run in
+    // parallel in the background so that they don't delay start up.
+    //
+    QHash<QString, QVersionNumber> versions;
+    QStringList uncachedPaths;
+
+    for (const QString &command : d->commands) {
+        QString path = QStandardPaths::findExecutable(command);
+
+        if (path.isEmpty()) {
+            qWarning() << "Command" << command << "is not available.";
+            continue;
+        }
+
+        d->commandPaths.insert(command, path);
+
+        QVersionNumber version;
+
+        if (d->cachedVersion(command, path, version)) {
+            versions.insert(path, version);
+        } else {
+            uncachedPaths.append(path);
+        }
+    }
+
+    if (uncachedPaths.isEmpty()) {
+        d->addConverterExporters(versions);
+    } else {
+        d->detectedVersions = versions;
+        d->detectionPending = true;
+        d->detectionWatcher->setFuture(
+            QtConcurrent::run(&ExporterFactoryPrivate::detectVersions,
+                uncachedPaths));
+    }
+}
+
+bool ExporterFactory::isDetectionFinished() const
+{
+    Q_D(const ExporterFactory);
+
+    return !d->detectionPending;
+}
+
+void ExporterFactory::waitForDetectionFinished()
+{
+    Q_D(ExporterFactory);
+
+    if (d->detectionPending) {
+        d->detectionWatcher->waitForFinished();
+        d->onDetectionFinished(d->detectionWatcher->result());
+    }
+}
+
+void ExporterFactoryPrivate::onDetectionFinished
+(
+    const QHash<QString, QVersionNumber> &versions
+)
+{
+    Q_Q(ExporterFactory);
+
+    // Guard against handling the results twice when
+    // waitForDetectionFinished() was called.
+    //
+    if (!detectionPending) {
+        return;
+    }
+
+    detectionPending = false;
+
+    for (const QString &command : commands) {
+        QString path = commandPaths.value(command);
+
+        if (versions.contains(path)) {
+            cacheVersion(command, path, versions.value(path));
+            detectedVersions.insert(path, versions.value(path));
+        }
+    }
+
+    addConverterExporters(detectedVersions);
+    emit q->exportersChanged();
+}
+
+bool ExporterFactoryPrivate::cachedVersion
+(
+    const QString &command,
+    const QString &path,
+    QVersionNumber &version
+) const
+{
+    QSettings settings;
+    settings.beginGroup(GW_CONVERTER_CACHE_GROUP);
+    settings.beginGroup(command);
+
+    if (!settings.contains("path")
+            || (settings.value("path").toString() != path)
+            || (settings.value("modified").toLongLong()
+                != QFileInfo(path).lastModified().toMSecsSinceEpoch())) {
+        return false;
+    }
+
+    // Note that an empty version is cached for executables that failed
+    // to run, so that they are not retried until they are updated.
+    //
+    version = QVersionNumber::fromString(settings.value("version").toString());
+    return true;
+}
+
+void ExporterFactoryPrivate::cacheVersion
+(
+    const QString &command,
+    const QString &path,
+    const QVersionNumber &version
+) const
+{
+    QSettings settings;
+    settings.beginGroup(GW_CONVERTER_CACHE_GROUP);
+    settings.beginGroup(command);
+    settings.setValue("path", path);
+    settings.setValue("modified",
+        QFileInfo(path).lastModified().toMSecsSinceEpoch());
+    settings.setValue("version", version.toString());
+}
+
+void ExporterFactoryPrivate::addConverterExporters
+(
+    const QHash<QString, QVersionNumber> &versions
+)
+{
+    CommandLineExporter *exporter = nullptr;
+    QVersionNumber pandocVersion = versions.value(commandPaths.value("pandoc"));
+    QVersionNumber mmdVersion = versions.value(commandPaths.value("multimarkdown"));
+    QVersionNumber cmarkVersion = versions.value(commandPaths.value("cmark"));
+
     if (!pandocVersion.isNull()) {
         int majorVersion = pandocVersion.majorVersion();
         int minorVersion = pandocVersion.minorVersion();
 
         // Check version of Pandoc. Drop support for version 1.
         if (majorVersion >= 2) {
-            d->addPandocExporter("Pandoc", "markdown", majorVersion, minorVersion);
+            addPandocExporter("Pandoc", "markdown", pandocVersion);
 
             if ((majorVersion > 1) ||
                 ((1 == majorVersion) && (minorVersion >= 14))) {
-                d->addPandocExporter("Pandoc CommonMark", "commonmark", majorVersion, minorVersion);
+                addPandocExporter("Pandoc CommonMark", "commonmark", pandocVersion);
             }
 
-            d->addPandocExporter("Pandoc GitHub-flavored Markdown", "markdown_github-hard_line_breaks", majorVersion, minorVersion);
-            d->addPandocExporter("Pandoc PHP Markdown Extra", "markdown_phpextra", majorVersion, minorVersion);
-            d->addPandocExporter("Pandoc MultiMarkdown", "markdown_mmd", majorVersion, minorVersion);
-            d->addPandocExporter("Pandoc Strict", "markdown_strict", majorVersion, minorVersion);
+            addPandocExporter("Pandoc GitHub-flavored Markdown", "markdown_github-hard_line_breaks", pandocVersion);
+            addPandocExporter("Pandoc PHP Markdown Extra", "markdown_phpextra", pandocVersion);
+            addPandocExporter("Pandoc MultiMarkdown", "markdown_mmd", pandocVersion);
+            addPandocExporter("Pandoc Strict", "markdown_strict", pandocVersion);
         }
         else {
             qWarning() << "Version" << pandocVersion << "of pandoc is unsupported.";
@@ -164,6 +362,7 @@ ExporterFactory::ExporterFactory()
         int majorVersion = mmdVersion.majorVersion();
 
         exporter = new CommandLineExporter("MultiMarkdown");
+        exporter->setVersion(mmdVersion.toString());
 
         // Smart typography option (--smart) is only available in version 5 and below.
         // The option is was removed and enabled by default in version 6 and above.
@@ -242,12 +441,13 @@ ExporterFactory::ExporterFactory()
             .arg(CommandLineExporter::SMART_TYPOGRAPHY_ARG)
             .arg(CommandLineExporter::OUTPUT_FILE_PATH_VAR)
         );
-        d->fileExporters.append(exporter);
-        d->htmlExporters.append(exporter);
+        fileExporters.append(exporter);
+        htmlExporters.append(exporter);
     }
 
     if (!cmarkVersion.isNull()) {
         exporter = new CommandLineExporter("cmark");
+        exporter->setVersion(cmarkVersion.toString());
         exporter->setSmartTypographyOnArgument("--smart");
         exporter->setHtmlRenderCommand(QString("cmark -t html --smart %1")
                                        .arg(CommandLineExporter::SMART_TYPOGRAPHY_ARG));
@@ -269,28 +469,56 @@ ExporterFactory::ExporterFactory()
             QString("cmark -t man %1")
             .arg(CommandLineExporter::SMART_TYPOGRAPHY_ARG)
         );
-        d->fileExporters.append(exporter);
-        d->htmlExporters.append(exporter);
+        fileExporters.append(exporter);
+        htmlExporters.append(exporter);
     }
 }
 
-QVersionNumber ExporterFactoryPrivate::isCommandAvailable(const QString &command,
-    const QStringList &args) const
+QHash<QString, QVersionNumber> ExporterFactoryPrivate::detectVersions
+(
+    const QStringList &paths
+)
 {
-    QProcess process;
-    process.start(command, args);
-
-    if (!process.waitForStarted(5000)) {
-        qWarning() << "Command" << command << "is not available.";
-        return QVersionNumber();
-    } else if (!process.waitForFinished(5000)) {
-        qCritical() << command << "process timed out and cannot be used.";
-        process.kill();
-        return QVersionNumber();
+    QHash<QString, QVersionNumber> versions;
+    QList<QProcess *> processes;
+
+    // Start all processes before waiting on any of them, so that they
+    // run in parallel.
+    //
+    for (const QString &path : paths) {
+        QProcess *process = new QProcess();
+        process->start(path, QStringList("--version"));
+        processes.append(process);
+    }
+
+    for (int i = 0; i < paths.size(); i++) {
+        QProcess *process = processes[i];
+        const QString &path = paths[i];
+
+        if (!process->waitForStarted(5000)) {
+            qWarning() << "Command" << path << "is not available.";
+            versions.insert(path, QVersionNumber());
+        } else if (!process->waitForFinished(5000)) {
+            qCritical() << path << "process timed out and cannot be used.";
+            process->kill();
+            process->waitForFinished(1000);
+            versions.insert(path, QVersionNumber());
+        } else {
+            QVersionNumber version = parseVersion(
+                QString::fromUtf8(process->readAllStandardOutput().data()));
+            qInfo().noquote() << "Using" << path << "version" << version.toString();
+            versions.insert(path, version);
+        }
+
+        delete process;
     }
 
-    // Extract the version number
-    QString versionStr = QString::fromUtf8(process.readAllStandardOutput().data());
+    return versions;
+}
+
+QVersionNumber ExporterFactoryPrivate::parseVersion(const QString &output)
+{
+    QString versionStr = output;
     const QRegularExpression versionRegex1("v(\\d+(\\.\\d+)*)");
     const QRegularExpression versionRegex2("(\\d+(\\.\\d+)*)");
     QRegularExpressionMatch match;
@@ -310,24 +538,18 @@ QVersionNumber ExporterFactoryPrivate::isCommandAvailable(const QString &command
         }
     }
 
-    QVersionNumber version = QVersionNumber::fromString(versionStr);
-    qInfo().noquote() << "Using" << command << "version" << version.toString();
-
-    return version;
+    return QVersionNumber::fromString(versionStr);
 }
 
 void ExporterFactoryPrivate::addPandocExporter
 (
     const QString &name,
     const QString &inputFormat,
-    int majorVersion,
-    int minorVersion
+    const QVersionNumber &version
 )
 {
-    Q_UNUSED(majorVersion)
-    Q_UNUSED(minorVersion)
-
     CommandLineExporter *exporter = new CommandLineExporter(name);
+    exporter->setVersion(version.toString());
 
     exporter->setSmartTypographyOnArgument("+smart");
     exporter->setSmartTypographyOffArgument("-smart");
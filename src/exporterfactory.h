@@ -8,6 +8,7 @@
 #define EXPORTERFACTORY_H
 
 #include <QList>
+#include <QObject>
 
 #include "exporter.h"
 
@@ -17,8 +18,9 @@ namespace ghostwriter
  * Creates Exporters for use with HTML live preview and exporting to disk.
  */
 class ExporterFactoryPrivate;
-class ExporterFactory
+class ExporterFactory : public QObject
 {
+    Q_OBJECT
     Q_DECLARE_PRIVATE(ExporterFactory)
 
 public:
@@ -49,6 +51,28 @@ public:
      */
     Exporter *exporterByName(const QString &name);
 
+    /**
+     * Returns true once the external processors (i.e., Pandoc) have been
+     * detected and their exporters added.  Processors are detected in
+     * the background at start up unless their versions were cached from
+     * a previous run, so only the built-in cmark-gfm exporter is
+     * guaranteed to be available before then.
+     */
+    bool isDetectionFinished() const;
+
+    /**
+     * Blocks until the external processors have been detected and
+     * their exporters added.
+     */
+    void waitForDetectionFinished();
+
+signals:
+    /**
+     * Emitted when exporters for external processors are added after
+     * detection in the background has finished.
+     */
+    void exportersChanged();
+
 private:
     QScopedPointer<ExporterFactoryPrivate> d_ptr;
 
@@ -0,0 +1,594 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QList>
+#include <QProcess>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include "commandlineexporter.h"
+#include "exportcache.h"
+#include "exportjobqueue.h"
+
+namespace ghostwriter
+{
+/*
+* An export that is queued or running.
+*/
+struct ExportJob
+{
+    int id;
+    Exporter *exporter;
+    const ExportFormat *format;
+    QString inputFilePath;
+    QString text;
+    QString outputFilePath;
+    bool smartTypographyEnabled;
+
+    // The running export process, or nullptr if the job is queued or
+    // runs on a worker thread.
+    QProcess *process;
+
+    // File the running export process writes to, which replaces the
+    // output file once the process succeeds.
+    QString partialFilePath;
+
+    // Key under which to store the exported file in the export cache,
+    // or empty if the result is not to be cached.
+    QByteArray cacheKey;
+
+    bool cancelled;
+};
+
+/*
+* Result of looking up a job's output in the export cache.
+*/
+struct ExportCacheLookup
+{
+    QByteArray key;
+    bool hit;
+};
+
+class ExportJobQueuePrivate
+{
+    Q_DECLARE_PUBLIC(ExportJobQueue)
+
+public:
+    static ExportJobQueue *instance;
+
+    ExportJobQueuePrivate(ExportJobQueue *q_ptr)
+        : q_ptr(q_ptr),
+          lastJobId(0),
+          maxConcurrentJobs(2),
+          finishedCount(0),
+          totalCount(0)
+    {
+        ;
+    }
+
+    ~ExportJobQueuePrivate()
+    {
+        ;
+    }
+
+    ExportJobQueue *q_ptr;
+
+    QList<ExportJob *> queuedJobs;
+    QList<ExportJob *> runningJobs;
+    int lastJobId;
+    int maxConcurrentJobs;
+    int finishedCount;
+    int totalCount;
+
+    // Runs exports that are not performed by an external process.
+    QThreadPool threadPool;
+
+    /*
+    * Starts queued jobs until the maximum number of concurrent jobs
+    * are running.
+    */
+    void startQueuedJobs();
+
+    /*
+    * Hashes the job's text and copies its output from the export cache,
+    * if cached, on the thread pool.  The job finishes early on a hit,
+    * and is exported otherwise.
+    */
+    void startCacheLookup(ExportJob *job);
+
+    void startExport(ExportJob *job);
+    void startProcessJob(ExportJob *job, CommandLineExporter *exporter);
+    void startThreadJob(ExportJob *job);
+    void onProcessFinished(ExportJob *job);
+
+    /*
+    * Returns a path next to the given output file for an export process
+    * to write to, keeping the output file's suffix, since processors
+    * such as pandoc choose the output format from it.
+    */
+    static QString partialFilePath(const ExportJob *job);
+
+    /*
+    * Replaces the job's output file with the file its process wrote,
+    * returning an error message on failure or else a null string.
+    */
+    static QString replaceOutputFile(const ExportJob *job);
+
+    /*
+    * Removes the job from the queue, reports its result, and deletes it.
+    */
+    void finishJob(ExportJob *job, const QString &err);
+};
+
+ExportJobQueue *ExportJobQueuePrivate::instance = nullptr;
+
+ExportJobQueue *ExportJobQueue::instance()
+{
+    if (nullptr == ExportJobQueuePrivate::instance) {
+        ExportJobQueuePrivate::instance = new ExportJobQueue();
+    }
+
+    return ExportJobQueuePrivate::instance;
+}
+
+ExportJobQueue::~ExportJobQueue()
+{
+    Q_D(ExportJobQueue);
+
+    qDeleteAll(d->queuedJobs);
+    d->queuedJobs.clear();
+
+    for (ExportJob *job : d->runningJobs) {
+        if (nullptr != job->process) {
+            job->process->disconnect();
+            job->process->kill();
+            job->process->waitForFinished();
+            delete job->process;
+            QFile::remove(job->partialFilePath);
+        }
+    }
+
+    d->threadPool.waitForDone();
+    qDeleteAll(d->runningJobs);
+    d->runningJobs.clear();
+}
+
+int ExportJobQueue::addJob
+(
+    Exporter *exporter,
+    const ExportFormat *format,
+    const QString &inputFilePath,
+    const QString &text,
+    const QString &outputFilePath,
+    bool smartTypographyEnabled
+)
+{
+    Q_D(ExportJobQueue);
+
+    ExportJob *job = new ExportJob();
+    job->id = ++d->lastJobId;
+    job->exporter = exporter;
+    job->format = format;
+    job->inputFilePath = inputFilePath;
+    job->text = text;
+    job->outputFilePath = outputFilePath;
+    job->smartTypographyEnabled = smartTypographyEnabled;
+    job->process = nullptr;
+    job->cancelled = false;
+
+    d->queuedJobs.append(job);
+    d->totalCount++;
+
+    emit progressChanged(d->finishedCount, d->totalCount);
+
+    d->startQueuedJobs();
+    return job->id;
+}
+
+int ExportJobQueue::pendingJobCount() const
+{
+    Q_D(const ExportJobQueue);
+
+    int count = d->queuedJobs.size();
+
+    for (const ExportJob *job : d->runningJobs) {
+        if (!job->cancelled) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int ExportJobQueue::maxConcurrentJobs() const
+{
+    Q_D(const ExportJobQueue);
+
+    return d->maxConcurrentJobs;
+}
+
+void ExportJobQueue::setMaxConcurrentJobs(int count)
+{
+    Q_D(ExportJobQueue);
+
+    d->maxConcurrentJobs = qMax(1, count);
+    d->startQueuedJobs();
+}
+
+void ExportJobQueue::cancelJob(int id)
+{
+    Q_D(ExportJobQueue);
+
+    for (ExportJob *job : d->queuedJobs) {
+        if (id == job->id) {
+            job->cancelled = true;
+            d->finishJob(job, QString());
+            return;
+        }
+    }
+
+    for (ExportJob *job : d->runningJobs) {
+        if (id == job->id) {
+            // The job is finished once the process exits, or once the
+            // worker thread is done with it.
+            //
+            job->cancelled = true;
+
+            if (nullptr != job->process) {
+                job->process->kill();
+            }
+
+            return;
+        }
+    }
+}
+
+void ExportJobQueue::cancelAll()
+{
+    Q_D(ExportJobQueue);
+
+    // Cancel queued jobs first so that none of them get started as the
+    // running jobs are cancelled.
+    //
+    while (!d->queuedJobs.isEmpty()) {
+        ExportJob *job = d->queuedJobs.first();
+        job->cancelled = true;
+        d->finishJob(job, QString());
+    }
+
+    for (ExportJob *job : d->runningJobs) {
+        job->cancelled = true;
+
+        if (nullptr != job->process) {
+            job->process->kill();
+        }
+    }
+}
+
+ExportJobQueue::ExportJobQueue()
+    : d_ptr(new ExportJobQueuePrivate(this))
+{
+    Q_D(ExportJobQueue);
+
+    // Exports that run in-process and export cache lookups are fast
+    // compared to exports run by external processors, so one thread is
+    // enough for them.
+    //
+    d->threadPool.setMaxThreadCount(1);
+}
+
+void ExportJobQueuePrivate::startQueuedJobs()
+{
+    Q_Q(ExportJobQueue);
+
+    while ((runningJobs.size() < maxConcurrentJobs) && !queuedJobs.isEmpty()) {
+        ExportJob *job = queuedJobs.takeFirst();
+        runningJobs.append(job);
+
+        emit q->jobStarted(job->id, job->outputFilePath);
+
+        if (ExportCache::instance()->isEnabled()) {
+            startCacheLookup(job);
+        } else {
+            startExport(job);
+        }
+    }
+}
+
+void ExportJobQueuePrivate::startCacheLookup(ExportJob *job)
+{
+    Q_Q(ExportJobQueue);
+
+    QFutureWatcher<ExportCacheLookup> *watcher =
+        new QFutureWatcher<ExportCacheLookup>(q);
+
+    q->connect
+    (
+        watcher,
+        &QFutureWatcher<ExportCacheLookup>::finished,
+        q,
+        [this, job, watcher]() {
+            ExportCacheLookup lookup = watcher->result();
+            watcher->deleteLater();
+
+            if (job->cancelled || lookup.hit) {
+                finishJob(job, QString());
+            } else {
+                job->cacheKey = lookup.key;
+                startExport(job);
+            }
+        }
+    );
+
+    Exporter *exporter = job->exporter;
+    const ExportFormat *format = job->format;
+    QString inputFilePath = job->inputFilePath;
+    QString text = job->text;
+    QString outputFilePath = job->outputFilePath;
+    bool smartTypographyEnabled = job->smartTypographyEnabled;
+
+    watcher->setFuture
+    (
+        QtConcurrent::run
+        (
+            &threadPool,
+            [exporter, format, inputFilePath, text, outputFilePath, smartTypographyEnabled]() {
+                ExportCacheLookup lookup;
+
+                lookup.key = ExportCache::key
+                    (
+                        exporter,
+                        format,
+                        inputFilePath,
+                        text,
+                        smartTypographyEnabled
+                    );
+                lookup.hit = ExportCache::instance()->fetch(lookup.key, outputFilePath);
+
+                return lookup;
+            }
+        )
+    );
+}
+
+void ExportJobQueuePrivate::startExport(ExportJob *job)
+{
+    CommandLineExporter *commandLineExporter =
+        dynamic_cast<CommandLineExporter *>(job->exporter);
+
+    if (nullptr != commandLineExporter) {
+        startProcessJob(job, commandLineExporter);
+    } else {
+        startThreadJob(job);
+    }
+}
+
+void ExportJobQueuePrivate::startProcessJob
+(
+    ExportJob *job,
+    CommandLineExporter *exporter
+)
+{
+    Q_Q(ExportJobQueue);
+
+    QString err;
+
+    // Write to a separate file so that cancelling or failing the export
+    // leaves any previously exported file intact, rather than truncated.
+    //
+    job->partialFilePath = partialFilePath(job);
+
+    job->process = exporter->startFileExport
+    (
+        job->format,
+        job->inputFilePath,
+        job->text,
+        job->partialFilePath,
+        job->smartTypographyEnabled,
+        err
+    );
+
+    // The process has its own copy of the text now.
+    job->text.clear();
+
+    if (nullptr == job->process) {
+        finishJob(job, err);
+        return;
+    }
+
+    q->connect
+    (
+        job->process,
+        QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+        q,
+        [this, job](int exitCode, QProcess::ExitStatus exitStatus) {
+            Q_UNUSED(exitCode)
+            Q_UNUSED(exitStatus)
+            onProcessFinished(job);
+        }
+    );
+
+    q->connect
+    (
+        job->process,
+        &QProcess::errorOccurred,
+        q,
+        [this, job](QProcess::ProcessError error) {
+            // The finished() signal is not emitted if the process
+            // could not be started at all.
+            //
+            if (QProcess::FailedToStart == error) {
+                onProcessFinished(job);
+            }
+        }
+    );
+
+    // The process may have failed to start before the above signals
+    // were connected.
+    //
+    if (QProcess::NotRunning == job->process->state()) {
+        onProcessFinished(job);
+    }
+}
+
+void ExportJobQueuePrivate::startThreadJob(ExportJob *job)
+{
+    Q_Q(ExportJobQueue);
+
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(q);
+
+    q->connect
+    (
+        watcher,
+        &QFutureWatcher<QString>::finished,
+        q,
+        [this, job, watcher]() {
+            finishJob(job, watcher->result());
+            watcher->deleteLater();
+        }
+    );
+
+    Exporter *exporter = job->exporter;
+    const ExportFormat *format = job->format;
+    QString inputFilePath = job->inputFilePath;
+    QString text = job->text;
+    QString outputFilePath = job->outputFilePath;
+    bool smartTypographyEnabled = job->smartTypographyEnabled;
+
+    job->text.clear();
+
+    watcher->setFuture
+    (
+        QtConcurrent::run
+        (
+            &threadPool,
+            [exporter, format, inputFilePath, text, outputFilePath, smartTypographyEnabled]() {
+                QString err;
+
+                // The exporter is shared, so leave its settings alone.
+                exporter->exportToFile
+                (
+                    format,
+                    inputFilePath,
+                    text,
+                    outputFilePath,
+                    smartTypographyEnabled,
+                    err
+                );
+
+                return err;
+            }
+        )
+    );
+}
+
+void ExportJobQueuePrivate::onProcessFinished(ExportJob *job)
+{
+    QProcess *process = job->process;
+    QString err;
+
+    if (!job->cancelled) {
+        if (QProcess::FailedToStart == process->error()) {
+            err = QObject::tr("Failed to execute command: %1")
+                .arg(process->errorString());
+        } else if ((QProcess::NormalExit != process->exitStatus())
+                || (0 != process->exitCode())) {
+            err = QString::fromUtf8(process->readAllStandardError()).trimmed();
+
+            if (err.isEmpty()) {
+                err = QObject::tr("Export failed with exit code %1")
+                    .arg(process->exitCode());
+            }
+        }
+    }
+
+    if (job->cancelled || !err.isNull()) {
+        QFile::remove(job->partialFilePath);
+    } else {
+        err = replaceOutputFile(job);
+    }
+
+    // Defer deleting the process, since this is called from one of its
+    // signals.
+    //
+    process->disconnect();
+    process->deleteLater();
+    job->process = nullptr;
+
+    finishJob(job, err);
+}
+
+QString ExportJobQueuePrivate::partialFilePath(const ExportJob *job)
+{
+    QFileInfo outputInfo(job->outputFilePath);
+    QString fileName = QString(".%1.%2-%3.part")
+        .arg(outputInfo.completeBaseName())
+        .arg(QCoreApplication::applicationPid())
+        .arg(job->id);
+
+    if (!outputInfo.suffix().isEmpty()) {
+        fileName += "." + outputInfo.suffix();
+    }
+
+    return outputInfo.dir().filePath(fileName);
+}
+
+QString ExportJobQueuePrivate::replaceOutputFile(const ExportJob *job)
+{
+    if (!QFileInfo::exists(job->partialFilePath)) {
+        return QObject::tr("The export command did not write %1")
+            .arg(QDir::toNativeSeparators(job->outputFilePath));
+    }
+
+    // QFile::rename() does not overwrite existing files.
+    if ((QFileInfo::exists(job->outputFilePath)
+                && !QFile::remove(job->outputFilePath))
+            || !QFile::rename(job->partialFilePath, job->outputFilePath)) {
+        QFile::remove(job->partialFilePath);
+
+        return QObject::tr("Could not replace %1")
+            .arg(QDir::toNativeSeparators(job->outputFilePath));
+    }
+
+    return QString();
+}
+
+void ExportJobQueuePrivate::finishJob(ExportJob *job, const QString &err)
+{
+    Q_Q(ExportJobQueue);
+
+    queuedJobs.removeOne(job);
+    runningJobs.removeOne(job);
+    finishedCount++;
+
+    if (!job->cancelled && err.isNull() && !job->cacheKey.isEmpty()) {
+        QByteArray cacheKey = job->cacheKey;
+        QString outputFilePath = job->outputFilePath;
+
+        threadPool.start([cacheKey, outputFilePath]() {
+            ExportCache::instance()->store(cacheKey, outputFilePath);
+        });
+    }
+
+    emit q->jobFinished(job->id, job->outputFilePath, err, job->cancelled);
+    emit q->progressChanged(finishedCount, totalCount);
+
+    delete job;
+
+    // Start counting progress anew for the next batch of exports.
+    if (queuedJobs.isEmpty() && runningJobs.isEmpty()) {
+        finishedCount = 0;
+        totalCount = 0;
+    }
+
+    startQueuedJobs();
+}
+} // namespace ghostwriter
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef EXPORTJOBQUEUE_H
+#define EXPORTJOBQUEUE_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+#include "exporter.h"
+#include "exportformat.h"
+
+namespace ghostwriter
+{
+/**
+ * Runs file exports in the background so that the user can keep editing
+ * while a slow export (such as a Pandoc to PDF conversion via LaTeX) is
+ * in progress.  Exports using command line processors run as
+ * asynchronous processes, and all other exports run on a worker thread.
+ * Jobs beyond the maximum number of concurrent jobs wait in the queue
+ * in the order they were added.
+ */
+class ExportJobQueuePrivate;
+class ExportJobQueue : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(ExportJobQueue)
+
+public:
+    /**
+     * Gets the singleton instance of this class.
+     */
+    static ExportJobQueue *instance();
+
+    /**
+     * Destructor.  Kills any export processes that are still running.
+     */
+    virtual ~ExportJobQueue();
+
+    /**
+     * Adds a job to export the given text to a file of the given format,
+     * and returns its ID.  The text is copied, so the document can be
+     * edited while the job is queued or running.  If there is no input
+     * file path due to the document being new and untitled, then specify
+     * a null or empty inputFilePath value.
+     */
+    int addJob
+    (
+        Exporter *exporter,
+        const ExportFormat *format,
+        const QString &inputFilePath,
+        const QString &text,
+        const QString &outputFilePath,
+        bool smartTypographyEnabled
+    );
+
+    /**
+     * Returns the number of jobs that are queued or running, not counting
+     * cancelled jobs that have yet to finish.
+     */
+    int pendingJobCount() const;
+
+    /**
+     * Returns the maximum number of jobs that can run at the same time.
+     */
+    int maxConcurrentJobs() const;
+
+    /**
+     * Sets the maximum number of jobs that can run at the same time.
+     */
+    void setMaxConcurrentJobs(int count);
+
+public slots:
+    /**
+     * Cancels the job with the given ID, killing its process if it is
+     * running.  A killed process leaves any previously exported file in
+     * place.  Jobs that run on a worker thread cannot be interrupted
+     * once started, but are reported as cancelled when done.
+     */
+    void cancelJob(int id);
+
+    /**
+     * Cancels all queued and running jobs.
+     */
+    void cancelAll();
+
+signals:
+    /**
+     * Emitted when the job with the given ID starts running.
+     */
+    void jobStarted(int id, const QString &outputFilePath);
+
+    /**
+     * Emitted when the job with the given ID has finished.  If the
+     * export failed, err is set to a non-null error message.  If the job
+     * was cancelled, cancelled is true.
+     */
+    void jobFinished
+    (
+        int id,
+        const QString &outputFilePath,
+        const QString &err,
+        bool cancelled
+    );
+
+    /**
+     * Emitted whenever a job is added or finished with the number of
+     * jobs finished and the total number of jobs added since the queue
+     * was last empty, so that the progress of a batch of exports can be
+     * displayed to the user.
+     */
+    void progressChanged(int finishedCount, int totalCount);
+
+private:
+    QScopedPointer<ExportJobQueuePrivate> d_ptr;
+
+    ExportJobQueue();
+};
+} // namespace ghostwriter
+
+#endif // EXPORTJOBQUEUE_H
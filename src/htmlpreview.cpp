@@ -16,6 +16,13 @@
 #include <QDesktopServices>
 #include <QtConcurrentRun>
 #include <QFuture>
+#include <QGuiApplication>
+#include <QHideEvent>
+#include <QtMath>
+#include <QScreen>
+#include <QShowEvent>
+#include <QTimer>
+#include <QVBoxLayout>
 #include <QWebChannel>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -23,10 +30,13 @@
 #include <QWebEngineSettings>
 #endif
 
+#include "appsettings.h"
 #include "exporter.h"
 #include "htmlpreview.h"
+#include "previewimageschemehandler.h"
 #include "previewproxy.h"
 #include "sandboxedwebpage.h"
+#include "tracer.h"
 
 namespace ghostwriter
 {
@@ -48,6 +58,10 @@ public:
 
     HtmlPreview *q_ptr;
 
+    QWebEngineView *view;
+    PreviewImageSchemeHandler *imageHandler;
+    QTimer *unloadTimer;
+    int unloadDelay;
     MarkdownDocument *document;
     bool updateInProgress;
     bool updateAgain;
@@ -61,6 +75,25 @@ public:
     void onHtmlReady();
     void onLoadFinished(bool ok);
 
+    /*
+    * Creates the web view, web page and web channel, and loads the
+    * wrapper HTML into them, if not already created.
+    */
+    void createView();
+
+    /*
+    * Destroys the web view and everything it owns to release the memory
+    * held by the web engine.  The preview proxy retains the last HTML
+    * content, style sheet, and math settings for when the view is
+    * created again.
+    */
+    void destroyView();
+
+    /*
+    * Shows the web view's context menu at the given position.
+    */
+    void showContextMenu(const QPoint &pos);
+
     /**
      * Sets the base directory path for determining resource
      * paths relative to the web page being previewed.
@@ -68,13 +101,17 @@ public:
      */
     void updateBaseDir();
     /*
-    * Sets the HTML contents to display, and creates a backup of the old
-    * HTML for diffing to scroll to the first difference whenever
-    * updatePreview() is called.
+    * Sets the HTML contents to display.
     */
     void setHtmlContent(const QString &html);
 
-    static QString exportToHtml(const QString &text, Exporter *exporter);
+    static QString exportToHtml
+    (
+        const QString &text,
+        Exporter *exporter,
+        const QString &baseDir,
+        int imageWidth
+    );
 };
 
 HtmlPreview::HtmlPreview
@@ -82,47 +119,43 @@ HtmlPreview::HtmlPreview
     MarkdownDocument *document,
     Exporter *exporter,
     QWidget *parent
-) : QWebEngineView(parent),
+) : QWidget(parent),
     d_ptr(new HtmlPreviewPrivate(this))
 {
     Q_D(HtmlPreview);
     
+    d->view = nullptr;
+    d->imageHandler = nullptr;
     d->document = document;
     d->updateInProgress = false;
     d->updateAgain = false;
     d->exporter = exporter;
     d->proxy.setMathEnabled(d->exporter->supportsMath());
 
+    this->connect(
+        &d->proxy,
+        &PreviewProxy::mathCacheHitsChanged,
+        this,
+        &HtmlPreview::mathCacheHitsChanged
+    );
+
     d->baseUrl = "";
 
-    this->setPage(new SandboxedWebPage(this));
-    this->settings()->setDefaultTextEncoding("utf-8");
-    this->settings()->setAttribute(
-        QWebEngineSettings::LocalContentCanAccessFileUrls,
-        true);
-    this->settings()->setAttribute(
-        QWebEngineSettings::LocalContentCanAccessRemoteUrls,
-        true);
+    QVBoxLayout *layout = new QVBoxLayout();
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(0);
+    this->setLayout(layout);
     this->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
-    this->page()->action(QWebEnginePage::Reload)->setVisible(false);
-    this->page()->action(QWebEnginePage::ReloadAndBypassCache)
-        ->setVisible(false);
-    this->page()->action(QWebEnginePage::OpenLinkInThisWindow)
-        ->setVisible(false);
-    this->page()->action(QWebEnginePage::OpenLinkInNewWindow)
-        ->setVisible(false);
-    this->page()->action(QWebEnginePage::ViewSource)->setVisible(false);
-    this->page()->action(QWebEnginePage::SavePage)->setVisible(false);
-    QWebEngineProfile::defaultProfile()
-        ->setHttpCacheType(QWebEngineProfile::NoCache);
-    QWebEngineProfile::defaultProfile()->clearHttpCache();
-    QWebEngineProfile::defaultProfile()->clearAllVisitedLinks();
+
+    d->unloadDelay = AppSettings::DEFAULT_HTML_PREVIEW_UNLOAD_DELAY;
+    d->unloadTimer = new QTimer(this);
+    d->unloadTimer->setSingleShot(true);
 
     this->connect(
-        this,
-        &QWebEngineView::loadFinished,
-        [d](bool ok) {
-            d->onLoadFinished(ok);
+        d->unloadTimer,
+        &QTimer::timeout,
+        [d]() {
+            d->destroyView();
         }
     );
 
@@ -145,29 +178,8 @@ HtmlPreview::HtmlPreview
         }
     );
 
-    // Set zoom factor for Chromium browser to account for system DPI settings,
-    // since Chromium assumes 96 DPI as a fixed resolution.
-    //
-    qreal horizontalDpi =
-        QGuiApplication::primaryScreen()->logicalDotsPerInchX();
-    this->setZoomFactor((horizontalDpi / 96.0));
-
-    QWebChannel *channel = new QWebChannel(this);
-    channel->registerObject(QStringLiteral("previewProxy"), &d->proxy);
-    this->page()->setWebChannel(channel);
-
-    QFile wrapperHtmlFile(":/resources/preview.html");
-
-    if (!wrapperHtmlFile.open(QFile::ReadOnly | QFile::Text)) {
-        d->wrapperHtml = tr("Error loading resources/preview.html");
-    } else {
-        QTextStream stream(&wrapperHtmlFile);
-        d->wrapperHtml = stream.readAll();
-        wrapperHtmlFile.close();
-    }
-
-    // Set the base URL and load the preview using wrapperHtml above.
-    d->updateBaseDir();
+    // Note that the web view itself is not created until the preview is
+    // first shown.  See showEvent().
 }
 
 HtmlPreview::~HtmlPreview()
@@ -178,19 +190,31 @@ HtmlPreview::~HtmlPreview()
     d->futureWatcher->waitForFinished();
 }
 
-void HtmlPreview::contextMenuEvent(QContextMenuEvent *event)
+int HtmlPreview::unloadDelay() const
 {
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    QMenu *menu = page()->createStandardContextMenu();
-#else
-    QMenu *menu = createStandardContextMenu();
-#endif
+    Q_D(const HtmlPreview);
 
-    menu->popup(event->globalPos());
+    return d->unloadDelay;
+}
+
+bool HtmlPreview::isLoaded() const
+{
+    Q_D(const HtmlPreview);
+
+    return (nullptr != d->view);
+}
+
+int HtmlPreview::mathCacheHits() const
+{
+    Q_D(const HtmlPreview);
+
+    return d->proxy.mathCacheHits();
 }
 
 void HtmlPreview::updatePreview()
 {
+    TraceScope trace("HtmlPreview::updatePreview");
+
     Q_D(HtmlPreview);
     
     if (d->updateInProgress) {
@@ -206,16 +230,31 @@ void HtmlPreview::updatePreview()
         if (d->document->isEmpty()) {
             d->setHtmlContent("");
         } else if (nullptr != d->exporter) {
-            QString text = d->document->toPlainText();
+            QString text = d->document->plainText();
 
             if (!text.isNull() && !text.isEmpty()) {
+                QString baseDir;
+
+                if (!d->document->filePath().isEmpty()) {
+                    baseDir = QFileInfo(d->document->filePath()).dir().absolutePath();
+                }
+
+                // Scale images to the preview's width in device pixels,
+                // rounded up to a multiple of 256 pixels so that resizing
+                // the preview does not reload every image.
+                //
+                int imageWidth = qCeil(
+                    (this->width() * this->devicePixelRatioF()) / 256.0) * 256;
+
                 d->updateInProgress = true;
                 QFuture<QString> future =
                     QtConcurrent::run
                     (
                         &HtmlPreviewPrivate::exportToHtml,
-                        d->document->toPlainText(),
-                        d->exporter
+                        text,
+                        d->exporter,
+                        baseDir,
+                        imageWidth
                     );
                 d->futureWatcher->setFuture(future);
             }
@@ -225,7 +264,13 @@ void HtmlPreview::updatePreview()
 
 void HtmlPreview::navigateToHeading(int headingSequenceNumber)
 {
-    this->page()->runJavaScript
+    Q_D(HtmlPreview);
+
+    if (nullptr == d->view) {
+        return;
+    }
+
+    d->view->page()->runJavaScript
     (
         QString
         (
@@ -234,6 +279,23 @@ void HtmlPreview::navigateToHeading(int headingSequenceNumber)
     );
 }
 
+void HtmlPreview::scrollToSourceLine(int lineNumber, qreal viewportRatio)
+{
+    Q_D(HtmlPreview);
+
+    if ((nullptr == d->view) || !this->isVisible()) {
+        return;
+    }
+
+    d->view->page()->runJavaScript
+    (
+        QString
+        (
+            "scrollToSourceLine(%1, %2);"
+        ).arg(lineNumber).arg(qBound(0.0, viewportRatio, 1.0))
+    );
+}
+
 void HtmlPreview::setHtmlExporter(Exporter *exporter)
 {
     Q_D(HtmlPreview);
@@ -258,8 +320,54 @@ void HtmlPreview::setMathEnabled(bool enabled)
     d->proxy.setMathEnabled(enabled);
 }
 
+void HtmlPreview::setUnloadDelay(int seconds)
+{
+    Q_D(HtmlPreview);
+
+    d->unloadDelay = qMax(0, seconds);
+
+    if (d->unloadTimer->isActive()) {
+        d->unloadTimer->stop();
+
+        if (d->unloadDelay > 0) {
+            d->unloadTimer->start(d->unloadDelay * 1000);
+        }
+    }
+}
+
+void HtmlPreview::showEvent(QShowEvent *event)
+{
+    Q_D(HtmlPreview);
+
+    QWidget::showEvent(event);
+
+    d->unloadTimer->stop();
+
+    if (nullptr == d->view) {
+        d->createView();
+    }
+}
+
+void HtmlPreview::hideEvent(QHideEvent *event)
+{
+    Q_D(HtmlPreview);
+
+    QWidget::hideEvent(event);
+
+    // Ignore spontaneous hide events, such as when the window is minimized.
+    if (event->spontaneous()) {
+        return;
+    }
+
+    if ((nullptr != d->view) && (d->unloadDelay > 0)) {
+        d->unloadTimer->start(d->unloadDelay * 1000);
+    }
+}
+
 void HtmlPreviewPrivate::onHtmlReady()
 {
+    TraceScope trace("HtmlPreview::onHtmlReady");
+
     Q_Q(HtmlPreview);
     
     setHtmlContent(futureWatcher->result());
@@ -274,10 +382,8 @@ void HtmlPreviewPrivate::onHtmlReady()
 
 void HtmlPreviewPrivate::onLoadFinished(bool ok)
 {
-    Q_Q(HtmlPreview);
-    
-    if (ok) {
-        q->page()->runJavaScript(
+    if (ok && (nullptr != view)) {
+        view->page()->runJavaScript(
             "document.documentElement.contentEditable = false;");
     }
 }
@@ -298,8 +404,123 @@ void HtmlPreviewPrivate::updateBaseDir()
         this->baseUrl = "";
     }
 
-    q->setHtml(wrapperHtml, QUrl(baseUrl));
-    q->updatePreview();
+    if (nullptr != view) {
+        view->setHtml(wrapperHtml, QUrl(baseUrl));
+        q->updatePreview();
+    }
+}
+
+void HtmlPreviewPrivate::createView()
+{
+    Q_Q(HtmlPreview);
+
+    if (nullptr != view) {
+        return;
+    }
+
+    if (wrapperHtml.isNull()) {
+        QFile wrapperHtmlFile(":/resources/preview.html");
+
+        if (!wrapperHtmlFile.open(QFile::ReadOnly | QFile::Text)) {
+            wrapperHtml = HtmlPreview::tr("Error loading resources/preview.html");
+        } else {
+            QTextStream stream(&wrapperHtmlFile);
+            wrapperHtml = stream.readAll();
+            wrapperHtmlFile.close();
+        }
+
+        QWebEngineProfile::defaultProfile()
+            ->setHttpCacheType(QWebEngineProfile::NoCache);
+        QWebEngineProfile::defaultProfile()->clearHttpCache();
+        QWebEngineProfile::defaultProfile()->clearAllVisitedLinks();
+    }
+
+    if (nullptr == imageHandler) {
+        imageHandler = new PreviewImageSchemeHandler(q);
+        QWebEngineProfile::defaultProfile()->installUrlSchemeHandler(
+            PreviewImageSchemeHandler::SCHEME,
+            imageHandler);
+    }
+
+    view = new QWebEngineView(q);
+    view->setPage(new SandboxedWebPage(view));
+    view->settings()->setDefaultTextEncoding("utf-8");
+    view->settings()->setAttribute(
+        QWebEngineSettings::LocalContentCanAccessFileUrls,
+        true);
+    view->settings()->setAttribute(
+        QWebEngineSettings::LocalContentCanAccessRemoteUrls,
+        true);
+    view->page()->action(QWebEnginePage::Reload)->setVisible(false);
+    view->page()->action(QWebEnginePage::ReloadAndBypassCache)
+        ->setVisible(false);
+    view->page()->action(QWebEnginePage::OpenLinkInThisWindow)
+        ->setVisible(false);
+    view->page()->action(QWebEnginePage::OpenLinkInNewWindow)
+        ->setVisible(false);
+    view->page()->action(QWebEnginePage::ViewSource)->setVisible(false);
+    view->page()->action(QWebEnginePage::SavePage)->setVisible(false);
+
+    view->setContextMenuPolicy(Qt::CustomContextMenu);
+
+    q->connect(
+        view,
+        &QWidget::customContextMenuRequested,
+        [this](const QPoint &pos) {
+            showContextMenu(pos);
+        }
+    );
+
+    q->connect(
+        view,
+        &QWebEngineView::loadFinished,
+        [this](bool ok) {
+            onLoadFinished(ok);
+        }
+    );
+
+    // Set zoom factor for Chromium browser to account for system DPI settings,
+    // since Chromium assumes 96 DPI as a fixed resolution.
+    //
+    qreal horizontalDpi =
+        QGuiApplication::primaryScreen()->logicalDotsPerInchX();
+    view->setZoomFactor((horizontalDpi / 96.0));
+
+    QWebChannel *channel = new QWebChannel(view);
+    channel->registerObject(QStringLiteral("previewProxy"), &proxy);
+    view->page()->setWebChannel(channel);
+
+    q->layout()->addWidget(view);
+
+    // Set the base URL and load the preview using wrapperHtml above.
+    updateBaseDir();
+}
+
+void HtmlPreviewPrivate::destroyView()
+{
+    if (nullptr == view) {
+        return;
+    }
+
+    view->hide();
+    view->deleteLater();
+    view = nullptr;
+}
+
+void HtmlPreviewPrivate::showContextMenu(const QPoint &pos)
+{
+    if (nullptr == view) {
+        return;
+    }
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    QMenu *menu = view->page()->createStandardContextMenu();
+#else
+    QMenu *menu = view->createStandardContextMenu();
+#endif
+
+    menu->setAttribute(Qt::WA_DeleteOnClose);
+    menu->popup(view->mapToGlobal(pos));
 }
 
 void HtmlPreview::closeEvent(QCloseEvent *event)
@@ -318,23 +539,23 @@ void HtmlPreviewPrivate::setHtmlContent(const QString &html)
 QString HtmlPreviewPrivate::exportToHtml
 (
     const QString &text,
-    Exporter *exporter
+    Exporter *exporter,
+    const QString &baseDir,
+    int imageWidth
 )
 {
-    QString html;
+    TraceScope trace("HtmlPreview::exportToHtml", LatencyMetricPreview);
 
-    // Enable smart typography for preview, if available for the exporter.
-    bool smartTypographyEnabled = exporter->smartTypographyEnabled();
-    exporter->setSmartTypographyEnabled(true);
-
-    // Export to HTML.
-    exporter->exportToHtml(text, html);
+    QString html;
 
-    // Put smart typography setting back to the way it was before
-    // so that the last setting used during document export is remembered.
+    // Enable smart typography for preview, if available for the exporter,
+    // and annotate the HTML with source positions so that the preview can
+    // be scrolled to match the editor.  Both are passed in for this call
+    // only, since the exporter is shared with the GUI thread.
     //
-    exporter->setSmartTypographyEnabled(smartTypographyEnabled);
+    exporter->exportToHtml(text, true, true, html);
 
-    return html;
+    // Have local images served scaled down to the preview's width.
+    return PreviewImageSchemeHandler::rewriteImageSources(html, baseDir, imageWidth);
 }
 } // namespace ghostwriter
@@ -23,10 +23,12 @@
 namespace ghostwriter
 {
 /**
- * Live HTML Preview window.
+ * Live HTML Preview window.  The web engine view that renders the
+ * preview is created when the preview is first shown, and destroyed
+ * after the preview has been hidden for the unload delay.
  */
 class HtmlPreviewPrivate;
-class HtmlPreview : public QWebEngineView
+class HtmlPreview : public QWidget
 {
     Q_OBJECT
     Q_DECLARE_PRIVATE(HtmlPreview)
@@ -49,9 +51,21 @@ public:
     virtual ~HtmlPreview();
 
     /**
-     * Customize QtWebEngine context menu.
+     * Returns the number of seconds the preview can remain hidden before
+     * its web engine view is destroyed, or 0 if it is never destroyed.
      */
-    void contextMenuEvent(QContextMenuEvent *event) override;
+    int unloadDelay() const;
+
+    /**
+     * Returns true if the web engine view is currently created.
+     */
+    bool isLoaded() const;
+
+    /**
+     * Returns the number of equations for which the preview reused a
+     * previously typeset rendering instead of calling MathJax again.
+     */
+    int mathCacheHits() const;
 
 public slots:
     /**
@@ -68,6 +82,15 @@ public slots:
      */
     void navigateToHeading(int headingSequenceNumber);
 
+    /**
+     * Call this method to scroll the preview so that the HTML rendered
+     * from the given Markdown source line number (starting at 1) appears
+     * at viewportRatio of the preview's height from its top, where 0.0
+     * is the top edge and 1.0 is the bottom edge.  Nothing happens if
+     * the exporter does not annotate its HTML with source positions.
+     */
+    void scrollToSourceLine(int lineNumber, qreal viewportRatio = 0.0);
+
     /**
      * Call this method to set the HTML exporter used in
      * generating HTML from the Markdown document.
@@ -84,8 +107,25 @@ public slots:
      */
     void setMathEnabled(bool enabled);
 
+    /**
+     * Call this method to set the number of seconds the preview can
+     * remain hidden before its web engine view is destroyed to free
+     * memory.  Pass in 0 to keep the view for the lifetime of the
+     * preview once it has been shown.
+     */
+    void setUnloadDelay(int seconds);
+
+signals:
+    /**
+     * Emitted when the number of equations whose cached rendering was
+     * reused by the preview changes.
+     */
+    void mathCacheHitsChanged(int hits);
+
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 private:
     QScopedPointer<HtmlPreviewPrivate> d_ptr;
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtMath>
+
+#include "latencyhistogram.h"
+
+namespace ghostwriter
+{
+LatencyHistogram::LatencyHistogram()
+    : counts(BUCKET_COUNT, 0),
+      total(0)
+{
+    ;
+}
+
+void LatencyHistogram::record(qint64 microseconds)
+{
+    counts[bucketIndex(microseconds)]++;
+    total++;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] += other.counts[i];
+    }
+
+    total += other.total;
+}
+
+void LatencyHistogram::clear()
+{
+    counts.fill(0);
+    total = 0;
+}
+
+qint64 LatencyHistogram::count() const
+{
+    return total;
+}
+
+qint64 LatencyHistogram::percentile(qreal percent) const
+{
+    if (total <= 0) {
+        return 0;
+    }
+
+    qint64 rank = qCeil((qBound(0.0, percent, 100.0) / 100.0) * total);
+    rank = qMax(rank, qint64(1));
+
+    qint64 seen = 0;
+
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+
+        if (seen >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+
+    return maximum();
+}
+
+qint64 LatencyHistogram::maximum() const
+{
+    for (int i = BUCKET_COUNT - 1; i >= 0; i--) {
+        if (counts[i] > 0) {
+            return bucketUpperBound(i);
+        }
+    }
+
+    return 0;
+}
+
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+    if (value < (2 * SUB_BUCKET_COUNT)) {
+        return int(qMax(value, qint64(0)));
+    }
+
+    int exponent = 63 - qCountLeadingZeroBits(quint64(value));
+
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+
+    // The top SUB_BUCKET_BITS + 1 bits of the value, the first of which
+    // is always set, pick the sub-bucket within the power of two.
+    //
+    int shift = exponent - SUB_BUCKET_BITS;
+    return (shift * SUB_BUCKET_COUNT) + int(value >> shift);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < (2 * SUB_BUCKET_COUNT)) {
+        return index;
+    }
+
+    int shift = (index / SUB_BUCKET_COUNT) - 1;
+    qint64 subBucket = (index % SUB_BUCKET_COUNT) + SUB_BUCKET_COUNT;
+
+    return ((subBucket + 1) << shift) - 1;
+}
+} // namespace ghostwriter
@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QVector>
+#include <QtGlobal>
+
+namespace ghostwriter
+{
+/**
+ * Histogram of latencies in the style of an HDR histogram.  Values are
+ * recorded in microseconds into logarithmically sized buckets, each power
+ * of two being split into 16 linear sub-buckets, so that percentiles are
+ * accurate to within about 6% at any scale, from microseconds to hours,
+ * while recording stays a constant-time array increment.
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * Constructor.  Creates an empty histogram.
+     */
+    LatencyHistogram();
+
+    /**
+     * Records a latency, in microseconds.
+     */
+    void record(qint64 microseconds);
+
+    /**
+     * Adds the counts of the given histogram to this one.
+     */
+    void merge(const LatencyHistogram &other);
+
+    /**
+     * Removes all recorded values.
+     */
+    void clear();
+
+    /**
+     * Returns the number of values recorded.
+     */
+    qint64 count() const;
+
+    /**
+     * Returns the value, in microseconds, below or at which the given
+     * percentage (between 0 and 100) of the recorded values fall.  The
+     * value is the upper bound of the bucket it falls in.  Returns 0 if no
+     * values were recorded.
+     */
+    qint64 percentile(qreal percent) const;
+
+    /**
+     * Returns the largest value recorded, in microseconds, to bucket
+     * precision.
+     */
+    qint64 maximum() const;
+
+private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+    // Values from 2^36 microseconds (about 19 hours) on are recorded in
+    // the last bucket.
+    //
+    static const int MAX_EXPONENT = 35;
+    static const int BUCKET_COUNT =
+        ((MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT) + SUB_BUCKET_COUNT;
+
+    QVector<qint64> counts;
+    qint64 total;
+
+    static int bucketIndex(qint64 value);
+    static qint64 bucketUpperBound(int index);
+};
+} // namespace ghostwriter
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,178 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QLocale>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include "latencyhud.h"
+#include "latencymonitor.h"
+#include "markdownast.h"
+#include "markdowndocument.h"
+
+namespace ghostwriter
+{
+class LatencyHudPrivate
+{
+    Q_DECLARE_PUBLIC(LatencyHud)
+
+public:
+    static const int REFRESH_INTERVAL = 1000;
+
+    LatencyHudPrivate(LatencyHud *q_ptr)
+        : q_ptr(q_ptr)
+    {
+        ;
+    }
+
+    ~LatencyHudPrivate()
+    {
+        ;
+    }
+
+    LatencyHud *q_ptr;
+    MarkdownDocument *document;
+    QTimer *timer;
+
+    void refresh();
+
+    /*
+    * Returns the given latency, in microseconds, formatted in
+    * milliseconds.
+    */
+    static QString milliseconds(qint64 latency);
+
+    static QString metricName(LatencyMetric metric);
+};
+
+LatencyHud::LatencyHud(MarkdownDocument *document, QWidget *parent)
+    : QLabel(parent),
+      d_ptr(new LatencyHudPrivate(this))
+{
+    Q_D(LatencyHud);
+
+    d->document = document;
+    d->timer = new QTimer(this);
+    d->timer->setInterval(LatencyHudPrivate::REFRESH_INTERVAL);
+
+    this->connect
+    (
+        d->timer,
+        &QTimer::timeout,
+        [d]() {
+            d->refresh();
+        }
+    );
+
+    d->timer->start();
+    d->refresh();
+}
+
+LatencyHud::~LatencyHud()
+{
+    ;
+}
+
+void LatencyHudPrivate::refresh()
+{
+    Q_Q(LatencyHud);
+
+    LatencyMonitor *monitor = LatencyMonitor::instance();
+
+    LatencyHistogram keystroke = monitor->histogram(LatencyMetricKeystrokeToPaint);
+    QStringList summary;
+
+    summary << LatencyHud::tr("key %1/%2/%3 ms")
+        .arg(milliseconds(keystroke.percentile(50.0)))
+        .arg(milliseconds(keystroke.percentile(95.0)))
+        .arg(milliseconds(keystroke.percentile(99.0)));
+    summary << LatencyHud::tr("parse %1")
+        .arg(milliseconds(monitor->histogram(LatencyMetricParse).percentile(99.0)));
+    summary << LatencyHud::tr("highlight %1")
+        .arg(milliseconds(monitor->histogram(LatencyMetricHighlight).percentile(99.0)));
+    summary << LatencyHud::tr("preview %1")
+        .arg(milliseconds(monitor->histogram(LatencyMetricPreview).percentile(99.0)));
+
+    QString astSummary;
+    MarkdownAST *ast = nullptr;
+
+    if (nullptr != document) {
+        ast = document->markdownAST();
+    }
+
+    if (nullptr != ast) {
+        astSummary = LatencyHud::tr("%1 nodes, %2")
+            .arg(ast->nodeCount())
+            .arg(QLocale().formattedDataSize(ast->memoryUsed()));
+        summary << astSummary;
+    }
+
+    q->setText(summary.join(QString(" · ")));
+
+    // Show every percentile in the tooltip.
+    QString table = QString("<table><tr><th></th><th>%1</th><th>%2</th>"
+        "<th>%3</th><th>%4</th><th>%5</th></tr>")
+        .arg(LatencyHud::tr("p50"))
+        .arg(LatencyHud::tr("p95"))
+        .arg(LatencyHud::tr("p99"))
+        .arg(LatencyHud::tr("max"))
+        .arg(LatencyHud::tr("count"));
+
+    for (int i = 0; i < LatencyMetricCount; i++) {
+        LatencyMetric metric = (LatencyMetric) i;
+        LatencyHistogram histogram = monitor->histogram(metric);
+
+        table += QString("<tr><td>%1</td><td align=\"right\">%2</td>"
+            "<td align=\"right\">%3</td><td align=\"right\">%4</td>"
+            "<td align=\"right\">%5</td><td align=\"right\">%6</td></tr>")
+            .arg(metricName(metric))
+            .arg(milliseconds(histogram.percentile(50.0)))
+            .arg(milliseconds(histogram.percentile(95.0)))
+            .arg(milliseconds(histogram.percentile(99.0)))
+            .arg(milliseconds(histogram.maximum()))
+            .arg(histogram.count());
+    }
+
+    table += "</table>";
+
+    table += "<p>" + LatencyHud::tr("Latencies in milliseconds over the "
+        "last %1 seconds.").arg(monitor->windowLength());
+
+    if (!astSummary.isEmpty()) {
+        table += "<br/>" + LatencyHud::tr("Syntax tree: %1").arg(astSummary);
+    }
+
+    table += "</p>";
+
+    q->setToolTip(table);
+}
+
+QString LatencyHudPrivate::milliseconds(qint64 latency)
+{
+    return QString::number(latency / 1000.0, 'f', 1);
+}
+
+QString LatencyHudPrivate::metricName(LatencyMetric metric)
+{
+    switch (metric) {
+    case LatencyMetricKeyPress:
+        return LatencyHud::tr("Key press");
+    case LatencyMetricPaint:
+        return LatencyHud::tr("Paint");
+    case LatencyMetricKeystrokeToPaint:
+        return LatencyHud::tr("Keystroke to paint");
+    case LatencyMetricParse:
+        return LatencyHud::tr("Parse");
+    case LatencyMetricHighlight:
+        return LatencyHud::tr("Highlight");
+    case LatencyMetricPreview:
+        return LatencyHud::tr("Preview");
+    default:
+        return QString();
+    }
+}
+} // namespace ghostwriter
@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef LATENCYHUD_H
+#define LATENCYHUD_H
+
+#include <QLabel>
+#include <QScopedPointer>
+
+namespace ghostwriter
+{
+class MarkdownDocument;
+
+/**
+ * A QLabel for the status bar that shows the percentiles of the
+ * keystroke-to-paint, parse, highlight and preview latencies recorded by
+ * the LatencyMonitor over its sliding window, along with the size of the
+ * given document's AST.  The full table of percentiles is shown in the
+ * label's tooltip.  Refreshes itself once per second.
+ */
+class LatencyHudPrivate;
+class LatencyHud : public QLabel
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(LatencyHud)
+
+public:
+    /**
+     * Constructor.
+     */
+    explicit LatencyHud(MarkdownDocument *document, QWidget *parent = nullptr);
+
+    /**
+     * Destructor.
+     */
+    virtual ~LatencyHud();
+
+private:
+    QScopedPointer<LatencyHudPrivate> d_ptr;
+};
+} // namespace ghostwriter
+
+#endif // LATENCYHUD_H
@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "latencymonitor.h"
+#include "tracer.h"
+
+namespace ghostwriter
+{
+class LatencyMonitorPrivate
+{
+public:
+    static LatencyMonitor *instance;
+
+    /*
+    * The sliding window is made of this many slots, each holding the
+    * values recorded during SLOT_LENGTH nanoseconds.  The oldest slot is
+    * cleared and reused as time moves on.
+    */
+    static const int SLOT_COUNT = 6;
+    static const qint64 SLOT_LENGTH = 10LL * 1000 * 1000 * 1000;
+
+    LatencyMonitorPrivate()
+        : currentSlot(0),
+          pendingKeyPressTime(-1)
+    {
+        ;
+    }
+
+    ~LatencyMonitorPrivate()
+    {
+        ;
+    }
+
+    // Guards all of the below.
+    mutable QMutex mutex;
+
+    LatencyHistogram windowSlots[LatencyMetricCount][SLOT_COUNT];
+
+    // Number of SLOT_LENGTH intervals since tracing started up to the
+    // most recent slot.
+    //
+    qint64 currentSlot;
+
+    // Start time of the earliest key press that has yet to be painted, or
+    // -1 if none.
+    //
+    qint64 pendingKeyPressTime;
+
+    /*
+    * Clears the slots that have fallen out of the window as of the given
+    * time.
+    */
+    void advance(qint64 time);
+};
+
+const char *LatencyMonitor::ENVIRONMENT_VARIABLE = "GHOSTWRITER_LATENCY_HUD";
+LatencyMonitor *LatencyMonitorPrivate::instance = nullptr;
+
+LatencyMonitor *LatencyMonitor::instance()
+{
+    if (nullptr == LatencyMonitorPrivate::instance) {
+        LatencyMonitorPrivate::instance = new LatencyMonitor();
+    }
+
+    return LatencyMonitorPrivate::instance;
+}
+
+LatencyMonitor::~LatencyMonitor()
+{
+    ;
+}
+
+void LatencyMonitor::record(LatencyMetric metric, qint64 startTime, qint64 endTime)
+{
+    Q_D(LatencyMonitor);
+
+    if ((metric < 0) || (metric >= LatencyMetricCount)) {
+        return;
+    }
+
+    QMutexLocker locker(&d->mutex);
+
+    d->advance(endTime);
+
+    int slot = d->currentSlot % LatencyMonitorPrivate::SLOT_COUNT;
+    d->windowSlots[metric][slot].record((endTime - startTime) / 1000);
+
+    switch (metric) {
+    case LatencyMetricKeyPress:
+        if (d->pendingKeyPressTime < 0) {
+            d->pendingKeyPressTime = startTime;
+        }
+        break;
+    case LatencyMetricPaint:
+        // The first paint after a key press is the one that shows it.
+        if (d->pendingKeyPressTime >= 0) {
+            d->windowSlots[LatencyMetricKeystrokeToPaint][slot]
+                .record((endTime - d->pendingKeyPressTime) / 1000);
+            d->pendingKeyPressTime = -1;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+LatencyHistogram LatencyMonitor::histogram(LatencyMetric metric) const
+{
+    Q_D(const LatencyMonitor);
+
+    LatencyHistogram histogram;
+
+    if ((metric < 0) || (metric >= LatencyMetricCount)) {
+        return histogram;
+    }
+
+    QMutexLocker locker(&d->mutex);
+
+    const_cast<LatencyMonitorPrivate *>(d)->advance(Tracer::timestamp());
+
+    for (int i = 0; i < LatencyMonitorPrivate::SLOT_COUNT; i++) {
+        histogram.merge(d->windowSlots[metric][i]);
+    }
+
+    return histogram;
+}
+
+int LatencyMonitor::windowLength() const
+{
+    return int((LatencyMonitorPrivate::SLOT_COUNT * LatencyMonitorPrivate::SLOT_LENGTH)
+        / (1000LL * 1000 * 1000));
+}
+
+LatencyMonitor::LatencyMonitor()
+    : d_ptr(new LatencyMonitorPrivate())
+{
+    ;
+}
+
+void LatencyMonitorPrivate::advance(qint64 time)
+{
+    qint64 slot = time / SLOT_LENGTH;
+
+    if (slot <= currentSlot) {
+        return;
+    }
+
+    // Clear every slot passed over, but no more than the whole window.
+    qint64 first = qMax(currentSlot + 1, slot - SLOT_COUNT + 1);
+
+    for (qint64 i = first; i <= slot; i++) {
+        for (int metric = 0; metric < LatencyMetricCount; metric++) {
+            windowSlots[metric][i % SLOT_COUNT].clear();
+        }
+    }
+
+    currentSlot = slot;
+}
+} // namespace ghostwriter
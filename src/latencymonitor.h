@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+#include <QScopedPointer>
+#include <QtGlobal>
+
+#include "latencyhistogram.h"
+
+namespace ghostwriter
+{
+/**
+ * Latencies tracked by the LatencyMonitor.  Trace scopes for the key press
+ * and paint stages also mark when a key press is waiting to be painted.
+ */
+enum LatencyMetric
+{
+    LatencyMetricNone = -1,
+    LatencyMetricKeyPress,
+    LatencyMetricPaint,
+    LatencyMetricKeystrokeToPaint,
+    LatencyMetricParse,
+    LatencyMetricHighlight,
+    LatencyMetricPreview,
+    LatencyMetricCount
+};
+
+/**
+ * Keeps latency histograms over a sliding window of the last minute, fed
+ * by the TraceScope objects in the editor's hot paths, for display in the
+ * LatencyHud.  Recording is thread-safe.
+ */
+class LatencyMonitorPrivate;
+class LatencyMonitor
+{
+    Q_DECLARE_PRIVATE(LatencyMonitor)
+
+public:
+    /**
+     * Name of the environment variable that, when set to a non-empty
+     * value, enables latency monitoring.
+     */
+    static const char *ENVIRONMENT_VARIABLE;
+
+    /**
+     * Returns the single instance of this class.
+     */
+    static LatencyMonitor *instance();
+
+    /**
+     * Destructor.
+     */
+    ~LatencyMonitor();
+
+    /**
+     * Records the start and end time of a stage, in nanoseconds as given
+     * by Tracer::timestamp().
+     */
+    void record(LatencyMetric metric, qint64 startTime, qint64 endTime);
+
+    /**
+     * Returns the histogram of the given metric over the sliding window.
+     */
+    LatencyHistogram histogram(LatencyMetric metric) const;
+
+    /**
+     * Returns the length of the sliding window, in seconds.
+     */
+    int windowLength() const;
+
+private:
+    QScopedPointer<LatencyMonitorPrivate> d_ptr;
+
+    LatencyMonitor();
+};
+} // namespace ghostwriter
+
+#endif // LATENCYMONITOR_H
@@ -37,8 +37,11 @@
 
 #include "library.h"
 #include "exporter.h"
+#include "exportcache.h"
 #include "exporterfactory.h"
+#include "exportjobqueue.h"
 #include "findreplace.h"
+#include "latencyhud.h"
 #include "localedialog.h"
 #include "mainwindow.h"
 #include "messageboxhelper.h"
@@ -48,6 +51,7 @@
 #include "simplefontdialog.h"
 #include "stylesheetbuilder.h"
 #include "themeselectiondialog.h"
+#include "tracer.h"
 #include "spelling/spellcheckdecorator.h"
 #include "spelling/spellcheckdialog.h"
 
@@ -118,6 +122,7 @@ MainWindow::MainWindow(const QString &filePath, QWidget *parent)
     documentManager = new DocumentManager(editor, this);
     documentManager->setAutoSaveEnabled(appSettings->autoSaveEnabled());
     documentManager->setFileBackupEnabled(appSettings->backupFileEnabled());
+    documentManager->setFileBackupCount(appSettings->backupFileCount());
     documentManager->setDraftLocation(appSettings->draftLocation());
     documentManager->setFileHistoryEnabled(appSettings->fileHistoryEnabled());
     setWindowTitle(documentManager->document()->displayName() + "[*] - " + qAppName());
@@ -128,6 +133,23 @@ MainWindow::MainWindow(const QString &filePath, QWidget *parent)
     connect(documentManager, SIGNAL(operationFinished()), this, SLOT(onOperationFinished()));
     connect(documentManager, SIGNAL(documentClosed()), this, SLOT(refreshRecentFiles()));
 
+    ExportCache::instance()->setEnabled(appSettings->exportCacheEnabled());
+    ExportCache::instance()->setMaxSize(appSettings->exportCacheMaxSize());
+
+    this->connect(appSettings,
+        &AppSettings::exportCacheEnabledChanged,
+        [](bool enabled) {
+            ExportCache::instance()->setEnabled(enabled);
+        }
+    );
+
+    this->connect(appSettings,
+        &AppSettings::exportCacheMaxSizeChanged,
+        [](int megabytes) {
+            ExportCache::instance()->setMaxSize(megabytes);
+        }
+    );
+
     editor->setAutoMatchEnabled('\"', appSettings->autoMatchCharEnabled('\"'));
     editor->setAutoMatchEnabled('\'', appSettings->autoMatchCharEnabled('\''));
     editor->setAutoMatchEnabled('(', appSettings->autoMatchCharEnabled('('));
@@ -228,6 +250,7 @@ MainWindow::MainWindow(const QString &filePath, QWidget *parent)
 
     connect(appSettings, SIGNAL(autoSaveChanged(bool)), documentManager, SLOT(setAutoSaveEnabled(bool)));
     connect(appSettings, SIGNAL(backupFileChanged(bool)), documentManager, SLOT(setFileBackupEnabled(bool)));
+    connect(appSettings, SIGNAL(backupFileCountChanged(int)), documentManager, SLOT(setFileBackupCount(int)));
     connect(appSettings, SIGNAL(tabWidthChanged(int)), editor, SLOT(setTabulationWidth(int)));
     connect(appSettings, SIGNAL(insertSpacesForTabsChanged(bool)), editor, SLOT(setInsertSpacesForTabs(bool)));
     connect(appSettings, SIGNAL(useUnderlineForEmphasisChanged(bool)), editor, SLOT(setUseUnderlineForEmphasis(bool)));
@@ -279,9 +302,42 @@ MainWindow::MainWindow(const QString &filePath, QWidget *parent)
         this
     );
 
-    connect(editor, SIGNAL(textChanged()), htmlPreview, SLOT(updatePreview()));
+    connect(documentManager->document(),
+        &MarkdownDocument::contentsRevised,
+        htmlPreview,
+        &HtmlPreview::updatePreview);
     connect(outlineWidget, SIGNAL(headingNumberNavigated(int)), htmlPreview, SLOT(navigateToHeading(int)));
     connect(appSettings, SIGNAL(currentHtmlExporterChanged(Exporter *)), htmlPreview, SLOT(setHtmlExporter(Exporter *)));
+    connect(appSettings, SIGNAL(htmlPreviewUnloadDelayChanged(int)), htmlPreview, SLOT(setUnloadDelay(int)));
+    htmlPreview->setUnloadDelay(appSettings->htmlPreviewUnloadDelay());
+
+    // Keep the preview scrolled to the Markdown source line at the text
+    // cursor, placed at the same relative height as in the editor, or to
+    // the first visible line when the editor is scrolled.
+    //
+    this->connect(
+        editor,
+        &MarkdownEditor::cursorPositionChanged,
+        [this]() {
+            qreal viewportHeight = qMax(1, editor->viewport()->height());
+
+            htmlPreview->scrollToSourceLine
+            (
+                editor->textCursor().blockNumber() + 1,
+                editor->cursorRect().top() / viewportHeight
+            );
+        }
+    );
+    this->connect(
+        editor->verticalScrollBar(),
+        &QScrollBar::valueChanged,
+        [this]() {
+            htmlPreview->scrollToSourceLine
+            (
+                editor->cursorForPosition(QPoint(0, 0)).blockNumber() + 1
+            );
+        }
+    );
 
     htmlPreview->setMinimumWidth(0.1 * qApp->primaryScreen()->size().width());
     htmlPreview->setObjectName("htmlpreview");
@@ -459,7 +515,7 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    if (documentManager->close()) {
+    if (confirmCancelExports() && documentManager->close()) {
         this->quitApplication();
     } else {
         event->ignore();
@@ -468,7 +524,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
 void MainWindow::quitApplication()
 {
-    if (documentManager->close()) {
+    if (confirmCancelExports() && documentManager->close()) {
         appSettings->store();
 
         QSettings windowSettings;
@@ -731,6 +787,49 @@ void MainWindow::onOperationFinished()
     qApp->processEvents();
 }
 
+void MainWindow::onExportProgressChanged(int finishedCount, int totalCount)
+{
+    if (finishedCount < totalCount) {
+        if (totalCount > 1) {
+            statusIndicator->setText(tr("exporting %1 of %2")
+                .arg(finishedCount + 1)
+                .arg(totalCount));
+        } else {
+            statusIndicator->setText(tr("exporting"));
+        }
+
+        statisticsIndicator->hide();
+        statusIndicator->show();
+        cancelExportButton->show();
+    } else {
+        statusIndicator->setText(QString());
+        cancelExportButton->hide();
+        statusIndicator->hide();
+        statisticsIndicator->show();
+    }
+}
+
+void MainWindow::onExportFinished
+(
+    int id,
+    const QString &outputFilePath,
+    const QString &err,
+    bool cancelled
+)
+{
+    Q_UNUSED(id)
+
+    if (cancelled) {
+        return;
+    }
+
+    if (!err.isNull()) {
+        MessageBoxHelper::critical(this, tr("Export failed."), err);
+    } else {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(outputFilePath));
+    }
+}
+
 void MainWindow::changeFont()
 {
     bool success;
@@ -771,7 +870,7 @@ void MainWindow::copyHtml()
             markdownText = c.selection().toPlainText();
         } else {
             // Get all text from the document.
-            markdownText = editor->toPlainText();
+            markdownText = documentManager->document()->plainText();
         }
 
         // Convert Markdown to HTML.
@@ -1120,6 +1219,12 @@ void MainWindow::buildStatusBar()
         timeIndicator->hide();
     }
 
+    if (Tracer::isMonitoring()) {
+        LatencyHud *latencyHud = new LatencyHud(documentManager->document(), this);
+        leftLayout->addWidget(latencyHud, 0, Qt::AlignLeft);
+        statusBarWidgets.append(latencyHud);
+    }
+
     statusBarLayout->addWidget(leftWidget, 1, 0, 1, 1, Qt::AlignLeft);
 
     // Add middle widgets to status bar.
@@ -1127,6 +1232,28 @@ void MainWindow::buildStatusBar()
     midLayout->addWidget(statusIndicator, 0, Qt::AlignCenter);
     statusIndicator->hide();
 
+    cancelExportButton = new QPushButton(QChar(fa::times));
+    cancelExportButton->setFocusPolicy(Qt::NoFocus);
+    cancelExportButton->setToolTip(tr("Cancel export"));
+    midLayout->addWidget(cancelExportButton, 0, Qt::AlignCenter);
+    statusBarWidgets.append(cancelExportButton);
+    cancelExportButton->hide();
+
+    ExportJobQueue *exportQueue = ExportJobQueue::instance();
+
+    this->connect(cancelExportButton,
+        &QPushButton::clicked,
+        exportQueue,
+        &ExportJobQueue::cancelAll);
+    this->connect(exportQueue,
+        &ExportJobQueue::progressChanged,
+        this,
+        &MainWindow::onExportProgressChanged);
+    this->connect(exportQueue,
+        &ExportJobQueue::jobFinished,
+        this,
+        &MainWindow::onExportFinished);
+
     statisticsIndicator = new StatisticsIndicator(this->documentStats, this->sessionStats, this);
 
     if ((appSettings->favoriteStatistic() >= 0)
@@ -1389,6 +1516,31 @@ void MainWindow::adjustEditor()
     this->editor->centerCursor();
 }
 
+bool MainWindow::confirmCancelExports()
+{
+    ExportJobQueue *exportQueue = ExportJobQueue::instance();
+
+    if (exportQueue->pendingJobCount() <= 0) {
+        return true;
+    }
+
+    int response = MessageBoxHelper::question
+        (
+            this,
+            tr("Exports are still in progress."),
+            tr("Do you want to cancel them and quit?"),
+            QMessageBox::Yes | QMessageBox::No,
+            QMessageBox::No
+        );
+
+    if (QMessageBox::Yes != response) {
+        return false;
+    }
+
+    exportQueue->cancelAll();
+    return true;
+}
+
 void MainWindow::applyTheme()
 {
     if (!theme.name().isNull() && !theme.name().isEmpty()) {
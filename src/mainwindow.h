@@ -76,6 +76,14 @@ private slots:
     void changeDocumentDisplayName(const QString &displayName);
     void onOperationStarted(const QString &description);
     void onOperationFinished();
+    void onExportProgressChanged(int finishedCount, int totalCount);
+    void onExportFinished
+    (
+        int id,
+        const QString &outputFilePath,
+        const QString &err,
+        bool cancelled
+    );
     void changeFont();
     void onFontSizeChanged(int size);
     void onSetLocale();
@@ -102,6 +110,7 @@ private:
     QPushButton *sidebarToggleButton;
     StatisticsIndicator *statisticsIndicator;
     QLabel *statusIndicator;
+    QPushButton *cancelExportButton;
     TimeLabel *timeIndicator;
     QPushButton *toggleSidebarButton;
     QPushButton *previewOptionsButton;
@@ -152,6 +161,12 @@ private:
     void buildSidebar();
 
     void adjustEditor();
+
+    /*
+    * Asks the user whether to cancel any exports that are still in
+    * progress.  Returns true if there are none or if they were cancelled.
+    */
+    bool confirmCancelExports();
 };
 } // namespace ghostwriter
 
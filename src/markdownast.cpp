@@ -182,6 +182,20 @@ QVector<MarkdownNode *> MarkdownAST::headings() const
     return headings;
 }
 
+int MarkdownAST::nodeCount() const
+{
+    Q_D(const MarkdownAST);
+
+    return int(d->arena.allocatedCount());
+}
+
+qint64 MarkdownAST::memoryUsed() const
+{
+    Q_D(const MarkdownAST);
+
+    return qint64(d->arena.reservedBytes());
+}
+
 void MarkdownAST::clear()
 {
     Q_D(MarkdownAST);
@@ -73,6 +73,16 @@ public:
      */
     QVector<MarkdownNode *> headings() const;
 
+    /**
+     * Returns the number of nodes in the AST.
+     */
+    int nodeCount() const;
+
+    /**
+     * Returns the number of bytes reserved for the AST's nodes.
+     */
+    qint64 memoryUsed() const;
+
     /**
      * Frees memory for this AST.
      */
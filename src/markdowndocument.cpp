@@ -8,6 +8,7 @@
 #include <QTextDocument>
 #include <QPlainTextDocumentLayout>
 #include <QFileInfo>
+#include <QTimer>
 
 #include "markdowndocument.h"
 
@@ -27,6 +28,15 @@ public:
     bool readOnlyFlag;
     QDateTime timestamp;
     MarkdownAST *ast;
+    int textRevision;
+    int lastDocumentRevision;
+
+    // Snapshot of the document text, valid for snapshotRevision.
+    QString snapshot;
+    int snapshotRevision;
+
+    QTimer *revisionTimer;
+    bool loading;
 
     MarkdownDocument *q_ptr;
 
@@ -34,6 +44,15 @@ public:
     * Initializes the class for an untitled document.
     */
     void initializeUntitledDocument();
+
+    /*
+    * Classifies each contentsChange() signal as either a text change or a
+    * format-only change (i.e., from a QSyntaxHighlighter re-highlighting a
+    * block or from the spell checker underlining a word).  Text changes
+    * increment the text revision and schedule the coalesced
+    * contentsRevised() signal.
+    */
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
 };
 
 MarkdownDocument::MarkdownDocument(QObject *parent)
@@ -149,6 +168,51 @@ void MarkdownDocument::setMarkdownAST(MarkdownAST *ast)
     d->ast = ast;
 }
 
+int MarkdownDocument::textRevision() const
+{
+    Q_D(const MarkdownDocument);
+
+    return d->textRevision;
+}
+
+QString MarkdownDocument::plainText() const
+{
+    Q_D(const MarkdownDocument);
+
+    if (d->snapshotRevision != d->textRevision) {
+        MarkdownDocumentPrivate *writableD =
+            const_cast<MarkdownDocumentPrivate *>(d);
+
+        writableD->snapshot = toPlainText();
+        writableD->snapshotRevision = d->textRevision;
+    }
+
+    return d->snapshot;
+}
+
+bool MarkdownDocument::isLoading() const
+{
+    Q_D(const MarkdownDocument);
+
+    return d->loading;
+}
+
+void MarkdownDocument::setLoading(bool loading)
+{
+    Q_D(MarkdownDocument);
+
+    if (loading == d->loading) {
+        return;
+    }
+
+    d->loading = loading;
+
+    if (!loading) {
+        d->revisionTimer->start();
+        emit loadingFinished();
+    }
+}
+
 void MarkdownDocument::clear()
 {
     QTextDocument::clear();
@@ -168,5 +232,66 @@ void MarkdownDocumentPrivate::initializeUntitledDocument()
     this->displayName = MarkdownDocument::tr("untitled");
     this->timestamp = QDateTime::currentDateTime();
     this->ast = nullptr;
+    this->textRevision = 0;
+    this->lastDocumentRevision = q->revision();
+    this->snapshotRevision = -1;
+    this->loading = false;
+
+    // Zero-interval single shot timer, so that all text changes made
+    // during the current event loop iteration result in only one
+    // contentsRevised() signal once control returns to the event loop.
+    //
+    this->revisionTimer = new QTimer(q);
+    this->revisionTimer->setSingleShot(true);
+    this->revisionTimer->setInterval(0);
+
+    q->connect(this->revisionTimer,
+        &QTimer::timeout,
+        q,
+        &MarkdownDocument::contentsRevised);
+
+    // NOTE: This connection is made in the constructor so that it is
+    // guaranteed to be the first receiver of contentsChange(), allowing
+    // other receivers to query textRevision() for the current change.
+    //
+    q->connect(q,
+        &MarkdownDocument::contentsChange,
+        q,
+        [this](int position, int charsRemoved, int charsAdded) {
+            onContentsChange(position, charsRemoved, charsAdded);
+        });
+}
+
+void MarkdownDocumentPrivate::onContentsChange
+(
+    int position,
+    int charsRemoved,
+    int charsAdded
+)
+{
+    Q_Q(MarkdownDocument);
+
+    // Format changes applied through the document layout (as is done by
+    // QSyntaxHighlighter) are reported with an equal number of characters
+    // removed and added, and do not bump the document's revision.
+    //
+    if ((charsRemoved == charsAdded)
+            && (q->revision() == lastDocumentRevision)) {
+        return;
+    }
+
+    lastDocumentRevision = q->revision();
+    textRevision++;
+
+    // Release the old snapshot now rather than when the next one is
+    // taken, so that large documents are not held twice in memory.
+    //
+    snapshot = QString();
+
+    if (!loading) {
+        revisionTimer->start();
+    }
+
+    emit q->textEdited(position, charsRemoved, charsAdded);
 }
 } // namespace ghostwriter
@@ -89,6 +89,42 @@ public:
     MarkdownAST *markdownAST() const;
     void setMarkdownAST(MarkdownAST *ast);
 
+    /**
+     * Returns a counter that is incremented every time the document's
+     * text (as opposed to only its formatting) changes.  Consumers can
+     * compare this value against a previously stored one to skip work
+     * when QTextDocument::contentsChange() was merely emitted for a
+     * formatting change by a syntax highlighter or the spell checker.
+     */
+    int textRevision() const;
+
+    /**
+     * Returns the document's text, as returned by toPlainText().  The
+     * text is copied out of the document at most once per text revision,
+     * and the same immutable snapshot is returned until the text changes
+     * again, so that consumers (i.e., the parser, live preview, and file
+     * saving) can all share it rather than making their own copies.
+     * Since QString is implicitly shared, the snapshot can be safely
+     * passed on to other threads, but this method itself must only be
+     * called from the thread that owns the document.
+     */
+    QString plainText() const;
+
+    /**
+     * Returns true while the document's text is being loaded from a
+     * file in chunks.  Consumers that analyze the text (i.e., the syntax
+     * highlighter and spell checker) should skip their work until the
+     * loadingFinished() signal is emitted.
+     */
+    bool isLoading() const;
+
+    /**
+     * Sets whether the document's text is being loaded from a file.
+     * The contentsRevised() signal is withheld while loading, and is
+     * emitted once loading is finished.
+     */
+    void setLoading(bool loading);
+
     /**
      * Overrides base class clear() method to send cleared() signal.
      */
@@ -105,6 +141,30 @@ signals:
      */
     void cleared();
 
+    /**
+     * Emitted after the document text has changed.  Unlike
+     * QTextDocument::textChanged() or contentsChange(), this signal is
+     * not emitted for format-only changes, and several text changes
+     * made during the same event loop iteration are coalesced into a
+     * single emission.  Connect expensive consumers of the whole
+     * document text (i.e., the live preview, outline, statistics) to
+     * this signal.
+     */
+    void contentsRevised();
+
+    /**
+     * Emitted immediately for each change to the document's text, with
+     * the same arguments as contentsChange(), but not for format-only
+     * changes.
+     */
+    void textEdited(int position, int charsRemoved, int charsAdded);
+
+    /**
+     * Emitted when the document's text has been loaded, after a call to
+     * setLoading(false).
+     */
+    void loadingFinished();
+
 private:
     QScopedPointer<MarkdownDocumentPrivate> d_ptr;
 };
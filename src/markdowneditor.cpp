@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <math.h>
 
+#include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QChar>
 #include <QColor>
@@ -16,6 +17,7 @@
 #include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFontMetrics>
 #include <QFontMetricsF>
 #include <QGridLayout>
 #include <QGuiApplication>
@@ -23,6 +25,7 @@
 #include <QImageReader>
 #include <QImageWriter>
 #include <QLayout>
+#include <QList>
 #include <QListWidget>
 #include <QMessageBox>
 #include <QMimeData>
@@ -30,6 +33,7 @@
 #include <QMimeType>
 #include <QPainter>
 #include <QPainterPath>
+#include <QPen>
 #include <QPixmap>
 #include <QPlainTextEdit>
 #include <QRegularExpression>
@@ -43,6 +47,7 @@
 #include <QStringLiteral>
 #include <QTextBoundaryFinder>
 #include <QTextCursor>
+#include <QTextLayout>
 #include <QTimer>
 #include <QUrl>
 
@@ -50,6 +55,8 @@
 #include "markdowneditor.h"
 #include "markdownhighlighter.h"
 #include "markdownstates.h"
+#include "textblockdata.h"
+#include "tracer.h"
 
 namespace ghostwriter
 {
@@ -158,6 +165,10 @@ public:
     static const int CursorWidth = 2;
     const QString lineBreakChar = QString::fromUtf8("↵");
 
+    // Bounding rect of lineBreakChar in lineBreakFont.
+    QFont lineBreakFont;
+    QRect lineBreakCharRect;
+
     // We use only image MIME types that are web-friendly so that any inserted
     // or pasted images can be displayed in the live preview.
     static const QStringList webMimeTypes;
@@ -170,6 +181,7 @@ public:
     MarkdownEditor *q_ptr;
 
     MarkdownDocument *textDocument;
+    int parsedTextRevision;
     MarkdownHighlighter *highlighter;
     QGridLayout *preferredLayout;
     bool autoMatchEnabled;
@@ -207,6 +219,17 @@ public:
     bool textCursorVisible;
     QTimer *cursorBlinkTimer;
 
+    // Backgrounds of the code block and block quote areas visible in the
+    // viewport, in viewport coordinates.  They are only recalculated when
+    // the document's layout or the visible part of it changes, and not
+    // every time the editor is repainted (i.e., when the cursor blinks).
+    //
+    QList<QPainterPath> blockAreaPaths;
+    bool blockAreasValid;
+    int blockAreasFirstBlock;
+    QPointF blockAreasOffset;
+    QSize blockAreasViewportSize;
+
     // Timers used to determine when typing has paused.
     QTimer *typingTimer;
     QTimer *scaledTypingTimer;
@@ -225,6 +248,18 @@ public:
     void toggleCursorBlink();
     void parseDocument();
 
+    /*
+    * Returns the bounding rect of the line break symbol in the editor's
+    * current font, measuring it only when the font has changed.
+    */
+    QRect lineBreakRect();
+
+    /*
+    * Lays out the visible right-to-left blocks as such, if they have been
+    * laid out anew since the last paint.
+    */
+    void updateTextDirection();
+
     void handleCarriageReturn();
     bool handleBackspaceKey();
     void insertPrefixForBlocks(const QString &prefix);
@@ -290,6 +325,7 @@ MarkdownEditor::MarkdownEditor
     Q_D(MarkdownEditor);
     
     d->textDocument = textDocument;
+    d->parsedTextRevision = -1;
     d->autoMatchEnabled = true;
     d->bulletPointCyclingEnabled = true;
     d->mouseButtonDown = false;
@@ -358,8 +394,37 @@ MarkdownEditor::MarkdownEditor
     connect(this->document(), SIGNAL(contentsChange(int, int, int)), this, SLOT(onContentsChanged(int, int, int)));
     connect(this, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
 
+    d->blockAreasValid = false;
+    d->blockAreasFirstBlock = -1;
+
+    // Changes to the text width or font change the geometry of the
+    // block areas without changing the document's contents.
+    //
+    this->connect
+    (
+        this->document()->documentLayout(),
+        &QAbstractTextDocumentLayout::update,
+        [d]() {
+            d->blockAreasValid = false;
+        }
+    );
+
     d->highlighter = new MarkdownHighlighter(this, colors);
 
+    // Parsing and highlighting are skipped while a file is loaded in
+    // chunks, so catch up once all of the text is in.
+    //
+    this->connect
+    (
+        d->textDocument,
+        &MarkdownDocument::loadingFinished,
+        [d]() {
+            d->parsedTextRevision = d->textDocument->textRevision();
+            d->parseDocument();
+            d->highlighter->rehighlightInBackground();
+        }
+    );
+
     d->typingPausedSignalSent = true;
     d->typingHasPaused = true;
 
@@ -415,15 +480,36 @@ QSyntaxHighlighter *MarkdownEditor::highlighter() const
 
 void MarkdownEditor::paintEvent(QPaintEvent *event)
 {
+    TraceScope trace("MarkdownEditor::paintEvent", LatencyMetricPaint);
+
     Q_D(MarkdownEditor);
     
     QPainter painter(viewport());
     QRect viewportRect = viewport()->rect();
     painter.fillRect(viewportRect, Qt::transparent);
 
+    d->updateTextDirection();
+
     QPointF offset(contentOffset());
     QTextBlock block = firstVisibleBlock();
 
+    // Only find the block areas anew if the layout changed, or if a
+    // different part of the document is visible.
+    //
+    if (!d->blockAreasValid
+            || (block.blockNumber() != d->blockAreasFirstBlock)
+            || (offset != d->blockAreasOffset)
+            || (viewportRect.size() != d->blockAreasViewportSize)) {
+        d->blockAreaPaths.clear();
+        d->blockAreasValid = true;
+        d->blockAreasFirstBlock = block.blockNumber();
+        d->blockAreasOffset = offset;
+        d->blockAreasViewportSize = viewportRect.size();
+    } else {
+        // Skip straight to drawing the cached backgrounds.
+        block = QTextBlock();
+    }
+
     bool firstVisible = true;
 
     QRectF blockAreaRect; // Code or block quote rect.
@@ -519,9 +605,7 @@ void MarkdownEditor::paintEvent(QPaintEvent *event)
         }
 
         if (drawBlock) {
-            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-            painter.setPen(Qt::NoPen);
-            painter.setBrush(QBrush(d->blockColor));
+            QPainterPath path;
 
             // If the first visible block is "clipped" such that the previous block
             // is part of the text block area, then only draw a rectangle with the
@@ -529,40 +613,36 @@ void MarkdownEditor::paintEvent(QPaintEvent *event)
             // that the first visible block is part of a larger block of text.
             //
             if (clipTop) {
-                QPainterPath path;
                 path.setFillRule(Qt::WindingFill);
                 path.addRoundedRect(blockAreaRect, cornerRadius, cornerRadius);
                 qreal adjustedHeight = blockAreaRect.height() / 2;
                 path.addRect(blockAreaRect.adjusted(0, 0, 0, -adjustedHeight));
-                painter.drawPath(path.simplified());
+                path = path.simplified();
                 clipTop = false;
             }
             // Else draw the entire rectangle with all corners rounded.
             else {
-                painter.drawRoundedRect(blockAreaRect, cornerRadius, cornerRadius);
+                path.addRoundedRect(blockAreaRect, cornerRadius, cornerRadius);
             }
 
+            d->blockAreaPaths.append(path);
             drawBlock = false;
         }
 
-        // This fixes the RTL bug of QPlainTextEdit
-        // https://bugreports.qt.io/browse/QTBUG-7516.
-        //
-        // Credit goes to Patrizio Bekerle (qmarkdowntextedit) for discovering
-        // this workaround.
-        //
-        if (block.text().isRightToLeft()) {
-            QTextLayout *layout = block.layout();
-            QTextOption opt = document()->defaultTextOption();
-            opt = QTextOption(Qt::AlignRight);
-            opt.setTextDirection(Qt::RightToLeft);
-            layout->setTextOption(opt);
-        }
-
         block = block.next();
         firstVisible = false;
     }
 
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QBrush(d->blockColor));
+
+    for (const QPainterPath &path : d->blockAreaPaths) {
+        if (path.intersects(QRectF(event->rect()))) {
+            painter.drawPath(path);
+        }
+    }
+
     painter.end();
 
     // Draw the visible editor text.
@@ -573,8 +653,19 @@ void MarkdownEditor::paintEvent(QPaintEvent *event)
     done = false;
     offset = contentOffset();
 
-    while (block.isValid() && !done) {        
+    QTextCursor textCursor = this->textCursor();
+    int cursorPosition = textCursor.position();
+    QRect breakRect = d->lineBreakRect();
+
+    painter.begin(viewport());
+    painter.setFont(this->font());
+
+    QPen selectedPen = painter.pen();
+    QPen whitespacePen(d->whitespaceRenderColor);
+
+    while (block.isValid() && !done) {
         QRectF r = this->blockBoundingRect(block).translated(offset);
+        TextBlockData *blockData = (TextBlockData *) block.userData();
 
         // If not in a code block, and the current block ends with two spaces
         // to indicate a line break in Markdown syntax, then draw the line
@@ -585,35 +676,40 @@ void MarkdownEditor::paintEvent(QPaintEvent *event)
         // at the end of a sentence and is in the habit of typing double spaces
         // after punctuation.
         //
-        if (!d->isCodeBlock(block)
-                && block.text().endsWith("  ")
-                && (this->textCursor().position()
-                    != (block.position() + block.length() - 1))) {
-            // Get position of last space character in the block.
-            QTextCursor c(block);
-            c.movePosition(QTextCursor::EndOfBlock);
-            c.movePosition(QTextCursor::PreviousCharacter);
-            QRect spaceRect = this->cursorRect(c);
-
-            // Calculate where to draw the line break character. We want it
-            // drawn over the space character.
-            QFontMetrics m(this->font());
-            QRect breakRect = m.tightBoundingRect(d->lineBreakChar);
-            dy = (breakRect.height() - spaceRect.height()) / 2;
-            QPoint pos(spaceRect.left(), spaceRect.bottom() + dy);
-
-            // Draw the line break character!
-            QPainter painter(viewport());
-            painter.setFont(this->font());
-
-            if (!this->textCursor().hasSelection()
-                    || (c.position() >= this->textCursor().selectionEnd())
-                    || (c.position() < this->textCursor().selectionStart())) {
-                painter.setPen(d->whitespaceRenderColor);
-            }
+        if ((nullptr != blockData)
+                && blockData->lineBreak
+                && !d->isCodeBlock(block)
+                && (cursorPosition != (block.position() + block.length() - 1))) {
+            // Get position of last space character in the block from the
+            // block's layout, which is drawn at the current offset.
+            //
+            int spacePosition = block.length() - 2;
+            QTextLine line = block.layout()->lineForTextPosition(spacePosition);
+
+            if (line.isValid()) {
+                // Calculate where to draw the line break character. We want it
+                // drawn over the space character.
+                //
+                qreal spaceBottom = offset.y() + line.y() + line.height() - 1;
+                QPointF pos
+                (
+                    offset.x() + line.cursorToX(spacePosition),
+                    spaceBottom + ((breakRect.height() - line.height()) / 2)
+                );
 
-            painter.drawText(pos, d->lineBreakChar);
-            painter.end();
+                int documentPosition = block.position() + spacePosition;
+
+                if (!textCursor.hasSelection()
+                        || (documentPosition >= textCursor.selectionEnd())
+                        || (documentPosition < textCursor.selectionStart())) {
+                    painter.setPen(whitespacePen);
+                } else {
+                    painter.setPen(selectedPen);
+                }
+
+                // Draw the line break character!
+                painter.drawText(pos, d->lineBreakChar);
+            }
         }
 
         block = block.next();
@@ -626,6 +722,8 @@ void MarkdownEditor::paintEvent(QPaintEvent *event)
         }
     }
 
+    painter.end();
+
     // Draw the text cursor/caret.
     if (d->textCursorVisible && this->hasFocus()) {
         // Get the cursor rect so that we have the ideal height for it,
@@ -680,11 +778,19 @@ void MarkdownEditor::setFocusMode(FocusMode mode)
         connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(focusText()));
         connect(this, SIGNAL(selectionChanged()), this, SLOT(focusText()));
         connect(this, SIGNAL(textChanged()), this, SLOT(focusText()));
+
+        // Only the visible text is faded, so fade the text anew whenever
+        // a different part of the document comes into view.
+        //
+        connect(this->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(focusText()), Qt::UniqueConnection);
+        connect(this->verticalScrollBar(), SIGNAL(rangeChanged(int, int)), this, SLOT(focusText()), Qt::UniqueConnection);
         this->focusText();
     } else {
         disconnect(this, SIGNAL(cursorPositionChanged()), this, SLOT(focusText()));
         disconnect(this, SIGNAL(selectionChanged()), this, SLOT(focusText()));
         disconnect(this, SIGNAL(textChanged()), this, SLOT(focusText()));
+        disconnect(this->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(focusText()));
+        disconnect(this->verticalScrollBar(), SIGNAL(rangeChanged(int, int)), this, SLOT(focusText()));
         this->setExtraSelections(QList<QTextEdit::ExtraSelection>());
     }
 }
@@ -979,6 +1085,8 @@ void MarkdownEditor::insertFromMimeData(const QMimeData *source)
 */
 void MarkdownEditor::keyPressEvent(QKeyEvent *e)
 {
+    TraceScope trace("MarkdownEditor::keyPressEvent", LatencyMetricKeyPress);
+
     Q_D(MarkdownEditor);
     
     int key = e->key();
@@ -1621,6 +1729,7 @@ void MarkdownEditor::setEditorCorners(InterfaceStyle corners)
     Q_D(MarkdownEditor);
     
     d->editorCorners = corners;
+    d->blockAreasValid = false;
 }
 
 void MarkdownEditor::increaseFontSize()
@@ -1647,21 +1756,38 @@ void MarkdownEditor::decreaseFontSize()
 
 void MarkdownEditor::onContentsChanged(int position, int charsAdded, int charsRemoved)
 {
+    TraceScope trace("MarkdownEditor::onContentsChanged");
+
     Q_D(MarkdownEditor);
     
     Q_UNUSED(position)
     Q_UNUSED(charsAdded)
     Q_UNUSED(charsRemoved)
 
-    d->parseDocument();
+    // Block states, and thus the block areas, can change along with the
+    // text's formatting.
+    //
+    d->blockAreasValid = false;
 
     // Don't use the textChanged() or contentsChanged() (no parameters) signals:
     // for checking if the typingResumed() signal needs to be emitted.  These
     // two signals: are emitted even when the text formatting changes (i.e.,
-    // when the QSyntaxHighlighter formats the text). Instead, use QTextDocument's
-    // onContentsChanged(int, int, int) signal, which is only emitted when the
-    // document text actually changes.
+    // when the QSyntaxHighlighter formats the text). The same is true of
+    // contentsChange(int, int, int), so rely on the document's text revision
+    // to skip re-parsing the document for format-only changes.
     //
+    if (d->textDocument->textRevision() == d->parsedTextRevision) {
+        return;
+    }
+
+    // Parse the document only once it has finished loading.
+    if (d->textDocument->isLoading()) {
+        return;
+    }
+
+    d->parsedTextRevision = d->textDocument->textRevision();
+    d->parseDocument();
+
     if (d->typingHasPaused || d->scaledTypingHasPaused) {
         d->typingHasPaused = false;
         d->scaledTypingHasPaused = false;
@@ -1703,45 +1829,101 @@ void MarkdownEditor::focusText()
 
         QList<QTextEdit::ExtraSelection> selections;
 
+        // Limit the faded text to the visible blocks, so that Qt does not
+        // have to apply the fade format to the whole document every time
+        // the cursor moves.
+        //
+        int visibleStart = this->firstVisibleBlock().position();
+        QTextBlock lastVisibleBlock =
+            this->cursorForPosition
+            (
+                QPoint(this->viewport()->width() - 1, this->viewport()->height() - 1)
+            ).block();
+        int visibleEnd = lastVisibleBlock.position() + lastVisibleBlock.length() - 1;
+
+        // Selects the visible text from the cursor back to the start of
+        // the visible text, returning false if none of the text before the
+        // cursor is visible.  The cursor itself may be below the visible
+        // text once the editor has been scrolled.
+        //
+        auto fadeBefore = [visibleStart, visibleEnd](QTextCursor &cursor) {
+            int end = qMin(cursor.position(), visibleEnd);
+
+            if (end <= visibleStart) {
+                return false;
+            }
+
+            cursor.setPosition(end);
+            cursor.setPosition(visibleStart, QTextCursor::KeepAnchor);
+            return true;
+        };
+
+        // Selects the visible text from the cursor to the end of the
+        // visible text, returning false if none of the text after the
+        // cursor is visible.  The cursor itself may be above the visible
+        // text once the editor has been scrolled.
+        //
+        auto fadeAfter = [visibleStart, visibleEnd](QTextCursor &cursor) {
+            int start = qMax(cursor.position(), visibleStart);
+
+            if (start >= visibleEnd) {
+                return false;
+            }
+
+            cursor.setPosition(start);
+            cursor.setPosition(visibleEnd, QTextCursor::KeepAnchor);
+            return true;
+        };
+
         switch (d->focusMode) {
         case FocusModeCurrentLine: // Current line
             beforeFadedSelection.cursor.movePosition(QTextCursor::StartOfLine);
             canFadePrevious = beforeFadedSelection.cursor.movePosition(QTextCursor::Up);
             beforeFadedSelection.cursor.movePosition(QTextCursor::EndOfLine);
-            beforeFadedSelection.cursor.movePosition(QTextCursor::Start, QTextCursor::KeepAnchor);
 
-            if (canFadePrevious) {
+            if (canFadePrevious && fadeBefore(beforeFadedSelection.cursor)) {
                 selections.append(beforeFadedSelection);
             }
 
             afterFadedSelection.cursor.movePosition(QTextCursor::EndOfLine);
-            afterFadedSelection.cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-            selections.append(afterFadedSelection);
+
+            if (fadeAfter(afterFadedSelection.cursor)) {
+                selections.append(afterFadedSelection);
+            }
+
             break;
 
         case FocusModeThreeLines: // Current line and previous two lines
             beforeFadedSelection.cursor.movePosition(QTextCursor::StartOfLine);
             canFadePrevious = beforeFadedSelection.cursor.movePosition(QTextCursor::Up, QTextCursor::MoveAnchor, 2);
             beforeFadedSelection.cursor.movePosition(QTextCursor::EndOfLine);
-            beforeFadedSelection.cursor.movePosition(QTextCursor::Start, QTextCursor::KeepAnchor);
 
-            if (canFadePrevious) {
+            if (canFadePrevious && fadeBefore(beforeFadedSelection.cursor)) {
                 selections.append(beforeFadedSelection);
             }
 
             afterFadedSelection.cursor.movePosition(QTextCursor::Down);
             afterFadedSelection.cursor.movePosition(QTextCursor::EndOfLine);
-            afterFadedSelection.cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-            selections.append(afterFadedSelection);
+
+            if (fadeAfter(afterFadedSelection.cursor)) {
+                selections.append(afterFadedSelection);
+            }
+
             break;
 
         case FocusModeParagraph: // Current paragraph
             canFadePrevious = beforeFadedSelection.cursor.movePosition(QTextCursor::StartOfBlock);
-            beforeFadedSelection.cursor.movePosition(QTextCursor::Start, QTextCursor::KeepAnchor);
-            selections.append(beforeFadedSelection);
+
+            if (fadeBefore(beforeFadedSelection.cursor)) {
+                selections.append(beforeFadedSelection);
+            }
+
             afterFadedSelection.cursor.movePosition(QTextCursor::EndOfBlock);
-            afterFadedSelection.cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-            selections.append(afterFadedSelection);
+
+            if (fadeAfter(afterFadedSelection.cursor)) {
+                selections.append(afterFadedSelection);
+            }
+
             break;
 
         case FocusModeSentence: { // Current sentence
@@ -1761,8 +1943,9 @@ void MarkdownEditor::focusText()
                 beforeFadedSelection.cursor.movePosition(QTextCursor::Left, QTextCursor::MoveAnchor, currentPos - lastSentencePos);
             }
 
-            beforeFadedSelection.cursor.movePosition(QTextCursor::Start, QTextCursor::KeepAnchor);
-            selections.append(beforeFadedSelection);
+            if (fadeBefore(beforeFadedSelection.cursor)) {
+                selections.append(beforeFadedSelection);
+            }
 
             if (nextSentencePos < 0) {
                 afterFadedSelection.cursor.movePosition(QTextCursor::EndOfBlock);
@@ -1770,8 +1953,9 @@ void MarkdownEditor::focusText()
                 afterFadedSelection.cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, nextSentencePos - currentPos);
             }
 
-            afterFadedSelection.cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-            selections.append(afterFadedSelection);
+            if (fadeAfter(afterFadedSelection.cursor)) {
+                selections.append(afterFadedSelection);
+            }
 
             break;
         }
@@ -1857,17 +2041,68 @@ void MarkdownEditorPrivate::toggleCursorBlink()
     Q_Q(MarkdownEditor);
     
     this->textCursorVisible = !this->textCursorVisible;
-    q->update();
+
+    // Only the cursor itself needs to be drawn or erased.
+    q->viewport()->update(q->cursorRect());
+}
+
+QRect MarkdownEditorPrivate::lineBreakRect()
+{
+    Q_Q(MarkdownEditor);
+
+    if (lineBreakCharRect.isNull() || (q->font() != lineBreakFont)) {
+        lineBreakFont = q->font();
+        lineBreakCharRect = QFontMetrics(lineBreakFont).tightBoundingRect(lineBreakChar);
+    }
+
+    return lineBreakCharRect;
+}
+
+void MarkdownEditorPrivate::updateTextDirection()
+{
+    Q_Q(MarkdownEditor);
+
+    QTextBlock block = q->firstVisibleBlock();
+    qreal top = q->contentOffset().y();
+    int height = q->viewport()->height();
+
+    // This fixes the RTL bug of QPlainTextEdit
+    // https://bugreports.qt.io/browse/QTBUG-7516.
+    //
+    // Credit goes to Patrizio Bekerle (qmarkdowntextedit) for discovering
+    // this workaround.
+    //
+    // The direction of the block's text is found by the highlighter only
+    // when the text changes.  The layout loses its text option whenever
+    // the block is laid out anew, so set it again only in that case.
+    //
+    while (block.isValid() && (top <= height)) {
+        TextBlockData *blockData = (TextBlockData *) block.userData();
+        QTextLayout *layout = block.layout();
+
+        if ((nullptr != blockData)
+                && blockData->rightToLeft
+                && (Qt::RightToLeft != layout->textOption().textDirection())) {
+            QTextOption opt(Qt::AlignRight);
+            opt.setTextDirection(Qt::RightToLeft);
+            layout->setTextOption(opt);
+        }
+
+        top += q->blockBoundingRect(block).height();
+        block = block.next();
+    }
 }
 
 void MarkdownEditorPrivate::parseDocument()
 {
+    TraceScope trace("MarkdownEditor::parseDocument", LatencyMetricParse);
+
     Q_Q(MarkdownEditor);
     
     MarkdownAST *ast =
         CmarkGfmAPI::instance()->parse
         (
-            q->document()->toPlainText(),
+            ((MarkdownDocument *) q->document())->plainText(),
             false
         );
 
@@ -4,13 +4,21 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>
+
 #include <QBrush>
 #include <QColor>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFont>
+#include <QHash>
+#include <QList>
 #include <QObject>
+#include <QPair>
 #include <QPainter>
+#include <QPoint>
 #include <QRegularExpression>
+#include <QScrollBar>
 #include <QStaticText>
 #include <QString>
 #include <QStringRef>
@@ -23,23 +31,106 @@
 #include <QApplication>
 #include <Qt>
 #include <QTextLayout>
+#include <QTimer>
 #include <QStack>
 
+#include "markdowndocument.h"
 #include "markdownhighlighter.h"
+#include "markdownlinescanner.h"
 #include "markdownstates.h"
+#include "textblockdata.h"
+#include "tracer.h"
 
 namespace ghostwriter
 {
+/*
+* Attributes of a character format applied by the highlighter, from
+* which the format itself is looked up in the highlighter's format table.
+*/
+struct HighlightFormat
+{
+    enum Color
+    {
+        Foreground,
+        Link,
+        Image,
+        InlineHtml,
+        HeadingText,
+        HeadingMarkup,
+        EmphasisText,
+        EmphasisMarkup,
+        BlockquoteText,
+        BlockquoteMarkup,
+        Divider,
+        ListMarkup,
+        CodeText,
+        CodeMarkup
+    };
+
+    HighlightFormat()
+        : color(Foreground),
+          bold(false),
+          italic(false),
+          underline(false),
+          strikeOut(false),
+          headingLevel(0)
+    {
+        ;
+    }
+
+    Color color;
+    bool bold;
+    bool italic;
+    bool underline;
+    bool strikeOut;
+
+    // Level of the heading whose larger font size to use, or 0 to use the
+    // default font size.
+    //
+    int headingLevel;
+
+    quint32 key() const
+    {
+        return quint32(color)
+            | (quint32(bold) << 8)
+            | (quint32(italic) << 9)
+            | (quint32(underline) << 10)
+            | (quint32(strikeOut) << 11)
+            | (quint32(headingLevel) << 12);
+    }
+};
+
 class MarkdownHighlighterPrivate
 {
     Q_DISABLE_COPY(MarkdownHighlighterPrivate)
     Q_DECLARE_PUBLIC(MarkdownHighlighter)
 
 public:
+    /*
+    * Time, in milliseconds, to spend highlighting blocks in the background
+    * before returning to the event loop.
+    */
+    static const int BACKGROUND_SLICE_TIME = 10;
+
+    /*
+    * Number of blocks to highlight in the background at a time.  Batches
+    * alternate between below and above the blocks that were visible when
+    * the background rehighlight started, so that the blocks nearest to
+    * them are highlighted first.
+    */
+    static const int BACKGROUND_BATCH_SIZE = 64;
+
     MarkdownHighlighterPrivate(MarkdownHighlighter *highlighter) :
         q_ptr(highlighter),
         inBlockquote(false),
-        useUnderlineForEmphasis(false)
+        useUnderlineForEmphasis(false),
+        backgroundTimer(nullptr),
+        backgroundAboveNextBlock(-1),
+        backgroundBelowNextBlock(-1),
+        backgroundNextBatchBelow(true),
+        lastHighlightedBlock(-1),
+        dirtyTimer(nullptr),
+        blockCount(0)
     {
         ;
     }
@@ -58,15 +149,125 @@ public:
     QRegularExpression heading1SetextRegex;
     QRegularExpression heading2SetextRegex;
     bool inBlockquote;
-    QRegularExpression referenceDefinitionRegex;
-    QRegularExpression inlineHtmlCommentRegex;
     bool useLargeHeadings;
     bool useUnderlineForEmphasis;
     bool italicizeBlockquotes;
 
+    QTimer *backgroundTimer;
+
+    // Ranges of block numbers (first and last) that the background
+    // rehighlight has yet to reach, sorted and without overlaps.  The
+    // rehighlight is done once there are none left.
+    //
+    QList<QPair<int, int>> backgroundPendingRanges;
+
+    // The background rehighlight works its way outward from the viewport,
+    // in alternating batches of the pending blocks at or above the former
+    // and at or below the latter.
+    //
+    int backgroundAboveNextBlock;
+    int backgroundBelowNextBlock;
+    bool backgroundNextBatchBelow;
+
+    // Last block highlighted by highlightBlock().
+    int lastHighlightedBlock;
+
+    // Ranges of block numbers (first and last) that need to be
+    // rehighlighted, sorted and with overlapping or adjoining ranges
+    // merged.
+    //
+    QList<QPair<int, int>> dirtyRanges;
+    QTimer *dirtyTimer;
+
+    // Number of blocks in the document as of its last change, for
+    // working out how many blocks a change added or removed.
+    //
+    int blockCount;
+
+    // Formats applied so far, keyed by HighlightFormat::key(), so that
+    // highlighting a block looks its formats up rather than building
+    // them anew.  Cleared whenever the colors or the font change.
+    //
+    QHash<quint32, QTextCharFormat> formats;
+
+    /*
+    * Returns the character format with the given attributes.
+    */
+    const QTextCharFormat &format(const HighlightFormat &attributes);
+
+    /*
+    * Returns the color scheme's color for the given color role.
+    */
+    QColor color(HighlightFormat::Color color) const;
+
+    /*
+    * Marks the block with the given number as needing to be rehighlighted,
+    * which is needed for setext headings and tables when the state of a
+    * following block changes.  Unfortunately, QSyntaxHighlighter only goes
+    * forward in its highlighting, not backwards.  Neither can
+    * rehighlightBlock() be called from within highlightBlock(), since
+    * recursive calls to the class will wipe its state data and will cause
+    * the application to crash.  Instead, the marked blocks are
+    * rehighlighted together once control returns to the event loop, so
+    * that each of them is rehighlighted only once however many times it
+    * was marked.
+    */
+    void markDirty(int blockNumber);
+
+    /*
+    * Returns true if the block with the given number is waiting for the
+    * background rehighlight to reach it.
+    */
+    bool isBackgroundPending(int blockNumber) const;
+
+    /*
+    * Rehighlights the pending blocks in the viewport, and has the
+    * background rehighlight continue outward from there.
+    */
+    void highlightVisibleBlocks();
+
+    /*
+    * Rehighlights the blocks in the given range that are pending.
+    */
+    void highlightPendingBlocks(int firstBlock, int lastBlock);
+
+    /*
+    * Finds the next batch of pending blocks below or above the blocks
+    * reached so far.  Returns false if there are none left on that side.
+    */
+    bool findBackgroundBatch(bool below, int &firstBlock, int &lastBlock) const;
+
+    /*
+    * Removes the given range of blocks from the pending blocks.
+    */
+    void removeBackgroundPending(int firstBlock, int lastBlock);
+
+    /*
+    * Rehighlights the given range of blocks for the background
+    * rehighlight.
+    */
+    void rehighlightBlocks(int firstBlock, int lastBlock);
+
+    /*
+    * Renumbers the pending, dirty and frontier block numbers after a
+    * change to the given block added (or, if negative, removed) the given
+    * number of blocks after it.
+    */
+    void shiftBlockNumbers(int changedBlock, int addedBlocks);
+
+    /*
+    * Returns the numbers of the first and last blocks visible in the
+    * editor.
+    */
+    void findVisibleBlocks(int &firstBlock, int &lastBlock) const;
+
     bool isSetextHeadingState(const int state);
     bool lineMatchesNode(const int line, const MarkdownNode *const node) const;
-    void applyFormattingForNode(const MarkdownNode *const node);
+    void applyFormattingForNode
+    (
+        const MarkdownNode *const node,
+        const QString &text
+    );
     void setupHeadingFontSize(bool useLargeHeadings);
 };
 
@@ -85,16 +286,53 @@ MarkdownHighlighter::MarkdownHighlighter
     d->italicizeBlockquotes = false;
     d->inBlockquote = false;
 
+    // Connect before setting the document, so that block numbers are
+    // shifted before QSyntaxHighlighter highlights the changed blocks.
+    //
+    connect
+    (
+        editor->document(),
+        &QTextDocument::contentsChange,
+        this,
+        &MarkdownHighlighter::onContentsChange
+    );
+
     setDocument(editor->document());
-    d->referenceDefinitionRegex.setPattern("^\\s*\\[(.+?)[^\\\\]\\]:");
-    d->inlineHtmlCommentRegex.setPattern("^\\s*<\\!--.*-->\\s*$");
+    d->blockCount = document()->blockCount();
+
+    d->dirtyTimer = new QTimer(this);
+    d->dirtyTimer->setSingleShot(true);
+    d->dirtyTimer->setInterval(0);
+
+    connect
+    (
+        d->dirtyTimer,
+        &QTimer::timeout,
+        this,
+        &MarkdownHighlighter::onDirtyBlocksTimeout
+    );
+
+    d->backgroundTimer = new QTimer(this);
+    d->backgroundTimer->setSingleShot(true);
+    d->backgroundTimer->setInterval(0);
 
     connect
     (
+        d->backgroundTimer,
+        &QTimer::timeout,
         this,
-        SIGNAL(highlightBlockAtPosition(int)),
+        &MarkdownHighlighter::onBackgroundRehighlightTimeout
+    );
+
+    // Queue the connection, since the editor may scroll while blocks are
+    // being highlighted, and the highlighter must not be reentered.
+    //
+    connect
+    (
+        editor->verticalScrollBar(),
+        &QScrollBar::valueChanged,
         this,
-        SLOT(onHighlightBlockAtPosition(int)),
+        &MarkdownHighlighter::onEditorScrolled,
         Qt::QueuedConnection
     );
 
@@ -128,11 +366,45 @@ MarkdownHighlighter::~MarkdownHighlighter()
 //
 void MarkdownHighlighter::highlightBlock(const QString &text)
 {
-    Q_UNUSED(text)
+    TraceScope trace("MarkdownHighlighter::highlightBlock", LatencyMetricHighlight);
 
     Q_D(MarkdownHighlighter);
 
-    int line = currentBlock().blockNumber() + 1;
+    int blockNumber = currentBlock().blockNumber();
+
+    // Leave blocks unhighlighted while the document is still loading, as
+    // well as blocks that a background rehighlight has yet to reach.
+    // Keeping the block's state unchanged stops QSyntaxHighlighter from
+    // cascading into the following blocks.
+    //
+    if (((MarkdownDocument *) this->document())->isLoading()
+            || d->isBackgroundPending(blockNumber)) {
+        setCurrentBlockState(currentBlock().userState());
+        return;
+    }
+
+    d->lastHighlightedBlock = blockNumber;
+
+    // Note whether the block ends in a line break for the editor, which
+    // draws a symbol over it, and whether its text is right-to-left, which
+    // the editor needs to lay it out.  Only allocate block data for blocks
+    // that need it.
+    //
+    bool lineBreak = text.endsWith(QStringLiteral("  "));
+    bool rightToLeft = text.isRightToLeft();
+    TextBlockData *blockData = (TextBlockData *) currentBlockUserData();
+
+    if ((nullptr == blockData) && (lineBreak || rightToLeft)) {
+        blockData = new TextBlockData((MarkdownDocument *) this->document(), currentBlock());
+        setCurrentBlockUserData(blockData);
+    }
+
+    if (nullptr != blockData) {
+        blockData->lineBreak = lineBreak;
+        blockData->rightToLeft = rightToLeft;
+    }
+
+    int line = blockNumber + 1;
     int oldState = currentBlock().userState();
 
     MarkdownAST *ast = ((MarkdownDocument *) this->document())->markdownAST();
@@ -143,22 +415,25 @@ void MarkdownHighlighter::highlightBlock(const QString &text)
     }
 
     if ((nullptr != node) && (MarkdownNode::Invalid != node->type())) {
-        d->applyFormattingForNode(node);
+        d->applyFormattingForNode(node, text);
     } else {
         setFormat(0, currentBlock().length(), d->colors.foreground);
 
-        if (currentBlock().text().trimmed().isEmpty()) {
+        int referenceLength = MarkdownLineScanner::referenceDefinitionLength(text);
+
+        if (MarkdownLineScanner::isBlank(text)) {
             setCurrentBlockState(MarkdownStateParagraphBreak);
-        } else if (d->referenceDefinitionRegex.match(currentBlock().text()).hasMatch()) {
-            QTextCharFormat format = d->defaultFormat;
-            format.setForeground(d->colors.link);
+        } else if (referenceLength > 0) {
+            HighlightFormat format;
+            format.color = HighlightFormat::Link;
 
-            setFormat(0, currentBlock().text().indexOf(':'), format);
+            // Leave the colon following the label unformatted.
+            setFormat(0, referenceLength - 1, d->format(format));
             setCurrentBlockState(MarkdownStateParagraph);
-        } else if (d->inlineHtmlCommentRegex.match(currentBlock().text()).hasMatch()) {
-            QTextCharFormat format = d->defaultFormat;
-            format.setForeground(d->colors.inlineHtml);
-            setFormat(0, currentBlock().text().length(), format);
+        } else if (MarkdownLineScanner::isInlineHtmlComment(text)) {
+            HighlightFormat format;
+            format.color = HighlightFormat::InlineHtml;
+            setFormat(0, text.length(), d->format(format));
 
             if (previousBlockState() != MarkdownStateUnknown) {
                 setCurrentBlockState(previousBlockState());
@@ -178,7 +453,7 @@ void MarkdownHighlighter::highlightBlock(const QString &text)
         }
 
         if (currentBlock() != block) {
-            emit highlightBlockAtPosition(block.position());
+            d->markDirty(block.blockNumber());
         }
     }
     else if (currentBlock().previous().isValid()
@@ -186,7 +461,7 @@ void MarkdownHighlighter::highlightBlock(const QString &text)
                     && (MarkdownStatePipeTableDivider != (currentBlockState() & MarkdownStateMask)))
                 || ((MarkdownStatePipeTableDivider != (oldState & MarkdownStateMask))
                     && (MarkdownStatePipeTableDivider == (currentBlockState() & MarkdownStateMask))))) {
-        emit highlightBlockAtPosition(currentBlock().previous().position());
+        d->markDirty(currentBlock().previous().blockNumber());
     }
 }
 
@@ -195,7 +470,8 @@ void MarkdownHighlighter::increaseFontSize()
     Q_D(MarkdownHighlighter);
 
     d->defaultFormat.setFontPointSize(d->defaultFormat.fontPointSize() + 1.0);
-    rehighlight();
+    d->formats.clear();
+    rehighlightInBackground();
 }
 
 void MarkdownHighlighter::decreaseFontSize()
@@ -203,7 +479,8 @@ void MarkdownHighlighter::decreaseFontSize()
     Q_D(MarkdownHighlighter);
     
     d->defaultFormat.setFontPointSize(d->defaultFormat.fontPointSize() - 1.0);
-    rehighlight();
+    d->formats.clear();
+    rehighlightInBackground();
 }
 
 void MarkdownHighlighter::setColorScheme(const ColorScheme &colors)
@@ -212,7 +489,8 @@ void MarkdownHighlighter::setColorScheme(const ColorScheme &colors)
     
     d->colors = colors;
     d->defaultFormat.setForeground(QBrush(colors.foreground));
-    rehighlight();
+    d->formats.clear();
+    rehighlightInBackground();
 }
 
 void MarkdownHighlighter::setEnableLargeHeadingSizes(const bool enable)
@@ -220,7 +498,7 @@ void MarkdownHighlighter::setEnableLargeHeadingSizes(const bool enable)
     Q_D(MarkdownHighlighter);
     
     d->useLargeHeadings = enable;
-    rehighlight();
+    rehighlightInBackground();
 }
 
 void MarkdownHighlighter::setUseUnderlineForEmphasis(const bool enable)
@@ -228,7 +506,7 @@ void MarkdownHighlighter::setUseUnderlineForEmphasis(const bool enable)
     Q_D(MarkdownHighlighter);
     
     d->useUnderlineForEmphasis = enable;
-    rehighlight();
+    rehighlightInBackground();
 }
 
 void MarkdownHighlighter::setItalicizeBlockquotes(const bool enable)
@@ -236,7 +514,7 @@ void MarkdownHighlighter::setItalicizeBlockquotes(const bool enable)
     Q_D(MarkdownHighlighter);
     
     d->italicizeBlockquotes = enable;
-    rehighlight();
+    rehighlightInBackground();
 }
 
 void MarkdownHighlighter::setFont(const QString &fontFamily, const double fontSize)
@@ -249,17 +527,363 @@ void MarkdownHighlighter::setFont(const QString &fontFamily, const double fontSi
     font.setItalic(false);
     font.setPointSizeF(fontSize);
     d->defaultFormat.setFont(font);
+    d->formats.clear();
+
+    rehighlightInBackground();
+}
+
+void MarkdownHighlighter::rehighlightInBackground()
+{
+    Q_D(MarkdownHighlighter);
+
+    d->backgroundPendingRanges.clear();
+    d->backgroundPendingRanges.append(qMakePair(0, document()->blockCount() - 1));
+    d->highlightVisibleBlocks();
+}
+
+void MarkdownHighlighter::onDirtyBlocksTimeout()
+{
+    Q_D(MarkdownHighlighter);
+
+    // Blocks marked while rehighlighting these are left for the next
+    // event loop iteration.
+    //
+    QList<QPair<int, int>> ranges = d->dirtyRanges;
+    d->dirtyRanges.clear();
+
+    int highlightedThrough = -1;
+
+    for (const QPair<int, int> &range : ranges) {
+        QTextBlock block =
+            document()->findBlockByNumber(qMax(range.first, highlightedThrough + 1));
+
+        // Rehighlighting a block also rehighlights the following blocks
+        // for as long as their states change, so skip past whatever was
+        // already highlighted, also for the ranges that follow.
+        //
+        while (block.isValid() && (block.blockNumber() <= range.second)) {
+            d->lastHighlightedBlock = -1;
+            rehighlightBlock(block);
+
+            highlightedThrough = qMax(block.blockNumber(), d->lastHighlightedBlock);
+            block = document()->findBlockByNumber(highlightedThrough + 1);
+        }
+    }
+}
+
+void MarkdownHighlighter::onBackgroundRehighlightTimeout()
+{
+    Q_D(MarkdownHighlighter);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!d->backgroundPendingRanges.isEmpty()
+            && (timer.elapsed() < MarkdownHighlighterPrivate::BACKGROUND_SLICE_TIME)) {
+        bool below = d->backgroundNextBatchBelow;
+        int firstBlock = 0;
+        int lastBlock = 0;
+
+        if (!d->findBackgroundBatch(below, firstBlock, lastBlock)) {
+            below = !below;
+
+            if (!d->findBackgroundBatch(below, firstBlock, lastBlock)) {
+                // Blocks added between the frontiers by an edit are all
+                // that is left, so close the gap between them.
+                //
+                d->backgroundBelowNextBlock = d->backgroundAboveNextBlock + 1;
+                continue;
+            }
+        }
+
+        d->removeBackgroundPending(firstBlock, lastBlock);
+        d->rehighlightBlocks(firstBlock, lastBlock);
+
+        if (below) {
+            d->backgroundBelowNextBlock = lastBlock + 1;
+        } else {
+            d->backgroundAboveNextBlock = firstBlock - 1;
+        }
+
+        d->backgroundNextBatchBelow = !below;
+    }
+
+    if (!d->backgroundPendingRanges.isEmpty()) {
+        d->backgroundTimer->start();
+    }
+}
+
+void MarkdownHighlighter::onEditorScrolled()
+{
+    Q_D(MarkdownHighlighter);
+
+    if (d->backgroundPendingRanges.isEmpty()) {
+        return;
+    }
+
+    int firstVisible = 0;
+    int lastVisible = 0;
+
+    d->findVisibleBlocks(firstVisible, lastVisible);
+
+    // If blocks that have yet to be reached scrolled into view, highlight
+    // them right away, and continue with the blocks around them next.
+    // The blocks already reached stay done.
+    //
+    for (const QPair<int, int> &range : d->backgroundPendingRanges) {
+        if ((range.first <= lastVisible) && (range.second >= firstVisible)) {
+            d->highlightVisibleBlocks();
+            break;
+        }
+    }
+}
+
+void MarkdownHighlighter::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_D(MarkdownHighlighter);
+
+    Q_UNUSED(charsRemoved)
+    Q_UNUSED(charsAdded)
+
+    int blockCount = document()->blockCount();
+    int addedBlocks = blockCount - d->blockCount;
+
+    d->blockCount = blockCount;
+
+    if (0 != addedBlocks) {
+        d->shiftBlockNumbers(document()->findBlock(position).blockNumber(), addedBlocks);
+    }
+}
+
+void MarkdownHighlighterPrivate::markDirty(int blockNumber)
+{
+    if (blockNumber < 0) {
+        return;
+    }
+
+    // Find the first range that ends at or after the block preceding this
+    // one, which is the only range that the block can overlap or adjoin.
+    //
+    QList<QPair<int, int>>::iterator iter = std::lower_bound
+        (
+            dirtyRanges.begin(),
+            dirtyRanges.end(),
+            blockNumber - 1,
+            [](const QPair<int, int> &range, int number) {
+                return range.second < number;
+            }
+        );
+
+    if ((dirtyRanges.end() == iter) || (iter->first > (blockNumber + 1))) {
+        dirtyRanges.insert(iter, qMakePair(blockNumber, blockNumber));
+    } else {
+        iter->first = qMin(iter->first, blockNumber);
+        iter->second = qMax(iter->second, blockNumber);
+
+        QList<QPair<int, int>>::iterator next = iter + 1;
+
+        if ((dirtyRanges.end() != next) && (next->first <= (iter->second + 1))) {
+            iter->second = qMax(iter->second, next->second);
+            dirtyRanges.erase(next);
+        }
+    }
+
+    if (!dirtyTimer->isActive()) {
+        dirtyTimer->start();
+    }
+}
+
+bool MarkdownHighlighterPrivate::isBackgroundPending(int blockNumber) const
+{
+    QList<QPair<int, int>>::const_iterator iter = std::lower_bound
+        (
+            backgroundPendingRanges.constBegin(),
+            backgroundPendingRanges.constEnd(),
+            blockNumber,
+            [](const QPair<int, int> &range, int number) {
+                return range.second < number;
+            }
+        );
+
+    return (backgroundPendingRanges.constEnd() != iter) && (iter->first <= blockNumber);
+}
+
+void MarkdownHighlighterPrivate::highlightVisibleBlocks()
+{
+    int firstVisible = 0;
+    int lastVisible = 0;
+
+    findVisibleBlocks(firstVisible, lastVisible);
+
+    backgroundAboveNextBlock = firstVisible - 1;
+    backgroundBelowNextBlock = lastVisible + 1;
+    backgroundNextBatchBelow = true;
+
+    // Highlight the visible blocks right away.  Their new formatting may
+    // change their height and bring more blocks into view, so keep going
+    // until the blocks below the viewport are reached.
+    //
+    highlightPendingBlocks(firstVisible, lastVisible);
+
+    for (int i = 0; i < 4; i++) {
+        findVisibleBlocks(firstVisible, lastVisible);
+
+        if (lastVisible < backgroundBelowNextBlock) {
+            break;
+        }
+
+        highlightPendingBlocks(backgroundBelowNextBlock, lastVisible);
+        backgroundBelowNextBlock = lastVisible + 1;
+    }
+
+    if (!backgroundPendingRanges.isEmpty()) {
+        backgroundTimer->start();
+    }
+}
+
+void MarkdownHighlighterPrivate::highlightPendingBlocks(int firstBlock, int lastBlock)
+{
+    QList<QPair<int, int>> ranges;
+
+    for (const QPair<int, int> &range : backgroundPendingRanges) {
+        if ((range.first <= lastBlock) && (range.second >= firstBlock)) {
+            ranges.append(qMakePair(qMax(range.first, firstBlock), qMin(range.second, lastBlock)));
+        }
+    }
+
+    for (const QPair<int, int> &range : ranges) {
+        removeBackgroundPending(range.first, range.second);
+        rehighlightBlocks(range.first, range.second);
+    }
+}
+
+bool MarkdownHighlighterPrivate::findBackgroundBatch
+(
+    bool below,
+    int &firstBlock,
+    int &lastBlock
+) const
+{
+    if (below) {
+        for (const QPair<int, int> &range : backgroundPendingRanges) {
+            if (range.second >= backgroundBelowNextBlock) {
+                firstBlock = qMax(range.first, backgroundBelowNextBlock);
+                lastBlock = qMin(firstBlock + BACKGROUND_BATCH_SIZE - 1, range.second);
+                return true;
+            }
+        }
+    } else {
+        for (int i = backgroundPendingRanges.size() - 1; i >= 0; i--) {
+            const QPair<int, int> &range = backgroundPendingRanges.at(i);
+
+            if (range.first <= backgroundAboveNextBlock) {
+                lastBlock = qMin(range.second, backgroundAboveNextBlock);
+                firstBlock = qMax(lastBlock - BACKGROUND_BATCH_SIZE + 1, range.first);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void MarkdownHighlighterPrivate::removeBackgroundPending(int firstBlock, int lastBlock)
+{
+    QList<QPair<int, int>> ranges;
 
-    rehighlight();
+    for (const QPair<int, int> &range : backgroundPendingRanges) {
+        if ((range.second < firstBlock) || (range.first > lastBlock)) {
+            ranges.append(range);
+            continue;
+        }
+
+        if (range.first < firstBlock) {
+            ranges.append(qMakePair(range.first, firstBlock - 1));
+        }
+
+        if (range.second > lastBlock) {
+            ranges.append(qMakePair(lastBlock + 1, range.second));
+        }
+    }
+
+    backgroundPendingRanges = ranges;
+}
+
+void MarkdownHighlighterPrivate::rehighlightBlocks(int firstBlock, int lastBlock)
+{
+    Q_Q(MarkdownHighlighter);
+
+    QTextBlock block = q->document()->findBlockByNumber(firstBlock);
+
+    // Rehighlighting a block also rehighlights the following blocks
+    // within the batch for as long as their states change, so skip
+    // past whatever was already highlighted.
+    //
+    while (block.isValid() && (block.blockNumber() <= lastBlock)) {
+        lastHighlightedBlock = -1;
+        q->rehighlightBlock(block);
+
+        int next = qMax(block.blockNumber(), lastHighlightedBlock) + 1;
+        block = q->document()->findBlockByNumber(next);
+    }
+}
+
+void MarkdownHighlighterPrivate::shiftBlockNumbers(int changedBlock, int addedBlocks)
+{
+    // Blocks after the changed one move by the number of blocks added.
+    // Those that were removed collapse onto the changed block.
+    //
+    auto shiftFirst = [changedBlock, addedBlocks](int blockNumber) {
+        if (blockNumber <= changedBlock) {
+            return blockNumber;
+        }
+
+        return qMax(blockNumber + addedBlocks, changedBlock + 1);
+    };
+
+    auto shiftLast = [changedBlock, addedBlocks](int blockNumber) {
+        if (blockNumber <= changedBlock) {
+            return blockNumber;
+        }
+
+        return qMax(blockNumber + addedBlocks, changedBlock);
+    };
+
+    auto shiftRanges = [shiftFirst, shiftLast](QList<QPair<int, int>> &ranges) {
+        QList<QPair<int, int>> shifted;
+
+        for (const QPair<int, int> &range : ranges) {
+            int first = shiftFirst(range.first);
+            int last = shiftLast(range.second);
+
+            if (first <= last) {
+                shifted.append(qMakePair(first, last));
+            }
+        }
+
+        ranges = shifted;
+    };
+
+    shiftRanges(backgroundPendingRanges);
+    shiftRanges(dirtyRanges);
+
+    backgroundAboveNextBlock = shiftLast(backgroundAboveNextBlock);
+    backgroundBelowNextBlock = shiftFirst(backgroundBelowNextBlock);
 }
 
-void MarkdownHighlighter::onHighlightBlockAtPosition(int position)
-{    
-    QTextBlock block = document()->findBlock(position);
-    rehighlightBlock(block);
+void MarkdownHighlighterPrivate::findVisibleBlocks(int &firstBlock, int &lastBlock) const
+{
+    QPoint bottom(0, editor->viewport()->height() - 1);
+
+    firstBlock = editor->cursorForPosition(QPoint(0, 0)).blockNumber();
+    lastBlock = qMax(firstBlock, editor->cursorForPosition(bottom).blockNumber());
 }
 
-void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *const node)
+void MarkdownHighlighterPrivate::applyFormattingForNode
+(
+    const MarkdownNode *const node,
+    const QString &text
+)
 {
     Q_Q(MarkdownHighlighter);
     
@@ -269,11 +893,9 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
     int currentLine = q->currentBlock().blockNumber() + 1;
     MarkdownState state = MarkdownStateParagraphBreak;
 
-    QTextCharFormat baseFormat = defaultFormat;
-    baseFormat.setForeground(colors.foreground);
+    HighlightFormat baseFormat;
 
     unsigned int indent = 0;
-    QString text = q->currentBlock().text();
 
     for (int i = 0; i < text.length(); i++) {
         if (text[i].isSpace()) {
@@ -286,33 +908,33 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
     bool inBlockquote = node->isInsideBlockquote();
 
     if (inBlockquote) {
-        baseFormat.setForeground(colors.blockquoteMarkup);
-        baseFormat.setFontItalic(italicizeBlockquotes);
+        baseFormat.color = HighlightFormat::BlockquoteMarkup;
+        baseFormat.italic = italicizeBlockquotes;
 
         q->setFormat(
             0,
             q->currentBlock().length(),
-            baseFormat
+            format(baseFormat)
         );
 
-        baseFormat.setForeground(colors.blockquoteText);
+        baseFormat.color = HighlightFormat::BlockquoteText;
     } else {
         q->setFormat(
             0,
             q->currentBlock().length(),
-            baseFormat
+            format(baseFormat)
         );
     }
 
     // Do a pre-order traversal of the nodes.
     QStack<const MarkdownNode *> nodes;
-    QStack<QTextCharFormat> nodeFormats;
+    QStack<HighlightFormat> nodeFormats;
     nodes.push(node);
     nodeFormats.push(baseFormat);
 
     while (!nodes.isEmpty()) {
         const MarkdownNode *current = nodes.pop();
-        QTextCharFormat contextFormat = nodeFormats.pop();
+        HighlightFormat contextFormat = nodeFormats.pop();
         MarkdownNode::NodeType parentType = MarkdownNode::Invalid;
 
         if (nullptr != current->parent()) {
@@ -329,26 +951,25 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
                 type = parentType;
             }
 
-            QTextCharFormat format = contextFormat;
+            HighlightFormat nodeFormat = contextFormat;
 
             switch (type) {
             case MarkdownNode::Heading:
                 length = q->currentBlock().length();
-                format.setFontWeight(QFont::Bold);
-                contextFormat.setFontWeight(QFont::Bold);
+                nodeFormat.bold = true;
+                contextFormat.bold = true;
 
                 if (useLargeHeadings) {
-                    format.setFontPointSize(format.fontPointSize()
-                                            + (qreal)(7 - current->headingLevel()));
-                    contextFormat.setFontPointSize(format.fontPointSize());
+                    nodeFormat.headingLevel = current->headingLevel();
+                    contextFormat.headingLevel = current->headingLevel();
                 }
 
                 if (inBlockquote) {
-                    format.setForeground(colors.blockquoteMarkup);
-                    contextFormat.setForeground(colors.blockquoteText);
+                    nodeFormat.color = HighlightFormat::BlockquoteMarkup;
+                    contextFormat.color = HighlightFormat::BlockquoteText;
                 } else {
-                    format.setForeground(colors.headingMarkup);
-                    contextFormat.setForeground(colors.headingText);
+                    nodeFormat.color = HighlightFormat::HeadingMarkup;
+                    contextFormat.color = HighlightFormat::HeadingText;
                 }
 
                 if (current->isSetextHeading()) {
@@ -365,11 +986,7 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
 
                     // Rehighlight all blocks contained within this heading node.
                     if (currentLine != current->startLine()) {
-                        QTextBlock block = q->document()->findBlockByNumber(current->startLine() - 1);
-
-                        if (block.isValid()) {
-                            emit q->highlightBlockAtPosition(block.position());
-                        }
+                        markDirty(current->startLine() - 1);
                     }
                 } else {
                     switch (current->headingLevel()) {
@@ -406,31 +1023,31 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
 
                 break;
             case MarkdownNode::BlockQuote:
-                format.setForeground(colors.blockquoteMarkup);
-                format.setFontItalic(italicizeBlockquotes);
-                contextFormat.setForeground(colors.blockquoteText);
-                contextFormat.setFontItalic(italicizeBlockquotes);
+                nodeFormat.color = HighlightFormat::BlockquoteMarkup;
+                nodeFormat.italic = italicizeBlockquotes;
+                contextFormat.color = HighlightFormat::BlockquoteText;
+                contextFormat.italic = italicizeBlockquotes;
                 inBlockquote = true;
                 break;
             case MarkdownNode::CodeBlock:
                 if (current->isFencedCodeBlock()
                         && (((q->currentBlock().blockNumber() + 1) == current->startLine())
                             || ((q->currentBlock().blockNumber() + 1) == current->endLine()))) {
-                    format.setForeground(colors.codeMarkup);
+                    nodeFormat.color = HighlightFormat::CodeMarkup;
                     state = MarkdownStateCodeBlock;
                 } else if (((q->currentBlock().blockNumber() + 1) == current->endLine())
                         && (current->length() <= 0)) {
                     state = MarkdownStateParagraphBreak;
                 } else {
-                    format.setForeground(colors.codeText);
+                    nodeFormat.color = HighlightFormat::CodeText;
                     length = q->currentBlock().length() - pos + 1;
                     state = MarkdownStateCodeBlock;
                 }
 
                 break;
             case MarkdownNode::ListItem:
-                format.setForeground(colors.listMarkup);
-                format.setFontWeight(QFont::Bold);
+                nodeFormat.color = HighlightFormat::ListMarkup;
+                nodeFormat.bold = true;
 
                 if (current->isNumberedListItem()) {
                     state = MarkdownStateNumberedList;
@@ -441,26 +1058,26 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
                 break;
             case MarkdownNode::TaskListItem:
                 state = MarkdownStateTaskList;
-                format.setForeground(colors.listMarkup);
-                format.setFontWeight(QFont::Bold);
+                nodeFormat.color = HighlightFormat::ListMarkup;
+                nodeFormat.bold = true;
                 break;
             case MarkdownNode::Emph:
-                format.setForeground(colors.emphasisMarkup);
+                nodeFormat.color = HighlightFormat::EmphasisMarkup;
 
                 if (useUnderlineForEmphasis) {
-                    contextFormat.setFontUnderline(true);
+                    contextFormat.underline = true;
                 } else {
-                    contextFormat.setFontItalic(true);
-                    format.setFontItalic(true);
+                    contextFormat.italic = true;
+                    nodeFormat.italic = true;
                 }
 
-                contextFormat.setForeground(colors.emphasisText);
+                contextFormat.color = HighlightFormat::EmphasisText;
                 break;
             case MarkdownNode::Strong:
-                contextFormat.setForeground(colors.emphasisText);
-                contextFormat.setFontWeight(QFont::Bold);
-                format.setForeground(colors.emphasisMarkup);
-                format.setFontWeight(QFont::Bold);
+                contextFormat.color = HighlightFormat::EmphasisText;
+                contextFormat.bold = true;
+                nodeFormat.color = HighlightFormat::EmphasisMarkup;
+                nodeFormat.bold = true;
                 break;
             case MarkdownNode::Code: {
                 int backticks = 0;
@@ -473,85 +1090,89 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
                     }
                 }
 
-                format.setForeground(colors.codeMarkup);
+                nodeFormat.color = HighlightFormat::CodeMarkup;
                 q->setFormat(
                     pos - backticks,
                     length + (2 * backticks),
-                    format
+                    format(nodeFormat)
                 );
-                format.setForeground(colors.codeText);
+                nodeFormat.color = HighlightFormat::CodeText;
                 break;
             }
             case MarkdownNode::HtmlInline:
-                format.setForeground(colors.inlineHtml);
-                contextFormat.setForeground(colors.inlineHtml);
+                nodeFormat.color = HighlightFormat::InlineHtml;
+                contextFormat.color = HighlightFormat::InlineHtml;
                 break;
             case MarkdownNode::Link:
-                format.setForeground(colors.link);
-                contextFormat.setForeground(colors.link);
+                nodeFormat.color = HighlightFormat::Link;
+                contextFormat.color = HighlightFormat::Link;
                 break;
             case MarkdownNode::Image:
-                format.setForeground(colors.image);
-                contextFormat.setForeground(colors.image);
+                nodeFormat.color = HighlightFormat::Image;
+                contextFormat.color = HighlightFormat::Image;
                 break;
             case MarkdownNode::ThematicBreak:
-                format.setForeground(colors.divider);
+                nodeFormat.color = HighlightFormat::Divider;
                 state = MarkdownStateHorizontalRule;
                 break;
             case MarkdownNode::FootnoteReference:
-                format.setForeground(colors.link);
-                contextFormat.setForeground(colors.link);
+                nodeFormat.color = HighlightFormat::Link;
+                contextFormat.color = HighlightFormat::Link;
                 break;
             case MarkdownNode::FootnoteDefinition:
-                format.setForeground(colors.link);
-                contextFormat.setForeground(colors.link);
+                nodeFormat.color = HighlightFormat::Link;
+                contextFormat.color = HighlightFormat::Link;
                 state = MarkdownStateParagraph;
                 break;
             case MarkdownNode::TableHeading:
-                format.setForeground(colors.emphasisMarkup);
+                nodeFormat.color = HighlightFormat::EmphasisMarkup;
                 pos = 0;
                 length = q->currentBlock().length();
-                contextFormat.setFontWeight(QFont::Bold);
+                contextFormat.bold = true;
                 state = MarkdownStatePipeTableHeader;
                 break;
             case MarkdownNode::TableRow:
-                format.setForeground(colors.emphasisMarkup);
+                nodeFormat.color = HighlightFormat::EmphasisMarkup;
                 pos = 0;
                 length = q->currentBlock().length();
                 state = MarkdownStatePipeTableRow;
                 break;
             case MarkdownNode::TableCell:
-                format = contextFormat;
+                nodeFormat = contextFormat;
 
                 if
                 (
                     (nullptr != current->parent())
                     && (MarkdownNode::TableHeading == current->parent()->type())
                 ) {
-                    format.setFontWeight(QFont::Bold);
+                    nodeFormat.bold = true;
                 }
                 break;
             case MarkdownNode::Table:
-                format.setForeground(colors.emphasisMarkup);
+                nodeFormat.color = HighlightFormat::EmphasisMarkup;
                 pos = 0;
                 length = q->currentBlock().length();
                 state = MarkdownStatePipeTableDivider;
                 break;
             case MarkdownNode::Strikethrough:
-                format.setForeground(colors.emphasisMarkup);
-                contextFormat.setFontStrikeOut(true);
+                nodeFormat.color = HighlightFormat::EmphasisMarkup;
+                contextFormat.strikeOut = true;
                 break;
-            default:
-                if (referenceDefinitionRegex.match(q->currentBlock().text()).hasMatch()) {
+            default: {
+                int referenceLength =
+                    MarkdownLineScanner::referenceDefinitionLength(text);
+
+                if (referenceLength > 0) {
                     pos = 0;
-                    length = q->currentBlock().text().indexOf(':') + 1;
-                    format.setForeground(colors.link);
+                    length = referenceLength;
+                    nodeFormat.color = HighlightFormat::Link;
                 } else if (inBlockquote) {
-                    format.setForeground(colors.blockquoteMarkup);
+                    nodeFormat.color = HighlightFormat::BlockquoteMarkup;
                 }
 
                 break;
             }
+            }
 
             if ((length <= 0) || (length > q->currentBlock().length())) {
                 length = q->currentBlock().length();
@@ -560,12 +1181,12 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
             q->setFormat(
                 pos,
                 length,
-                format
+                format(nodeFormat)
             );
 
             if (MarkdownNode::TaskListItem == type) {
-                format = contextFormat;
-                format.setForeground(colors.link);
+                nodeFormat = contextFormat;
+                nodeFormat.color = HighlightFormat::Link;
 
                 int checkboxStart = text.indexOf('[');
                 int checkboxEnd = text.indexOf(']');
@@ -573,7 +1194,7 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
                 q->setFormat(
                     checkboxStart,
                     checkboxEnd - checkboxStart + 1,
-                    format
+                    format(nodeFormat)
                 );
             }
         }
@@ -598,6 +1219,65 @@ void MarkdownHighlighterPrivate::applyFormattingForNode(const MarkdownNode *cons
     }
 }
 
+const QTextCharFormat &MarkdownHighlighterPrivate::format(const HighlightFormat &attributes)
+{
+    quint32 key = attributes.key();
+    QHash<quint32, QTextCharFormat>::iterator iter = formats.find(key);
+
+    if (formats.end() != iter) {
+        return iter.value();
+    }
+
+    QTextCharFormat format = defaultFormat;
+
+    format.setForeground(color(attributes.color));
+    format.setFontWeight(attributes.bold ? QFont::Bold : QFont::Normal);
+    format.setFontItalic(attributes.italic);
+    format.setFontUnderline(attributes.underline);
+    format.setFontStrikeOut(attributes.strikeOut);
+
+    if (attributes.headingLevel > 0) {
+        format.setFontPointSize(defaultFormat.fontPointSize()
+                                + (qreal)(7 - attributes.headingLevel));
+    }
+
+    return formats.insert(key, format).value();
+}
+
+QColor MarkdownHighlighterPrivate::color(HighlightFormat::Color color) const
+{
+    switch (color) {
+    case HighlightFormat::Link:
+        return colors.link;
+    case HighlightFormat::Image:
+        return colors.image;
+    case HighlightFormat::InlineHtml:
+        return colors.inlineHtml;
+    case HighlightFormat::HeadingText:
+        return colors.headingText;
+    case HighlightFormat::HeadingMarkup:
+        return colors.headingMarkup;
+    case HighlightFormat::EmphasisText:
+        return colors.emphasisText;
+    case HighlightFormat::EmphasisMarkup:
+        return colors.emphasisMarkup;
+    case HighlightFormat::BlockquoteText:
+        return colors.blockquoteText;
+    case HighlightFormat::BlockquoteMarkup:
+        return colors.blockquoteMarkup;
+    case HighlightFormat::Divider:
+        return colors.divider;
+    case HighlightFormat::ListMarkup:
+        return colors.listMarkup;
+    case HighlightFormat::CodeText:
+        return colors.codeText;
+    case HighlightFormat::CodeMarkup:
+        return colors.codeMarkup;
+    default:
+        return colors.foreground;
+    }
+}
+
 bool MarkdownHighlighterPrivate::lineMatchesNode(const int line, const MarkdownNode *const node) const
 {
     return ((node->isBlockType()
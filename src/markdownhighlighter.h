@@ -82,27 +82,42 @@ public:
      */
     void setFont(const QString &fontFamily, const double fontSize);
 
-signals:
     /**
-     * FOR INTERNAL USE ONLY
-     *
-     * This signal is used internally to restart highlighting on the
-     * previous line, which is needed for setext headings.  Unfortunately,
-     * QSyntaxHighlighter only goes forward in its highlighting, not
-     * backwards.  Neither can rehighlightBlock() be called internally,
-     * since recursive calls to the class will wipe its state data and will
-     * cause the application to crash. This is a workaround to queue a
-     * highlighting action for the prior text block in the event system,
-     * so that recursion isn't used.
+     * Rehighlights the whole document progressively, so that the
+     * application stays responsive while a very large document is
+     * highlighted.  The blocks visible in the editor are highlighted
+     * right away.  The rest are highlighted in small time slices,
+     * returning to the event loop in between, starting with the blocks
+     * nearest to the viewport.  Blocks that have yet to be reached keep
+     * their current formatting until then.  Changing any of the above
+     * settings rehighlights the document this way.
      */
-    void highlightBlockAtPosition(int position);
+    void rehighlightInBackground();
 
 private slots:
     /*
-    * Highlights the text block at the given cursor position of the
-    * document.  See explanation for highlightBlockAtPosition().
+    * Rehighlights the blocks that were marked as needing it while
+    * highlighting others.  See MarkdownHighlighterPrivate::markDirty().
     */
-    void onHighlightBlockAtPosition(int position);
+    void onDirtyBlocksTimeout();
+
+    /*
+    * Highlights the next time slice's worth of blocks for
+    * rehighlightInBackground().
+    */
+    void onBackgroundRehighlightTimeout();
+
+    /*
+    * Highlights blocks scrolled into view that the background
+    * rehighlight has yet to reach.
+    */
+    void onEditorScrolled();
+
+    /*
+    * Keeps the block numbers of the background rehighlight and of the
+    * blocks marked dirty in step with blocks added or removed by an edit.
+    */
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
 
 private:
     QScopedPointer<MarkdownHighlighterPrivate> d_ptr;
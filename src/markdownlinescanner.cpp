@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QLatin1String>
+
+#include "markdownlinescanner.h"
+
+namespace ghostwriter
+{
+bool MarkdownLineScanner::isBlank(QStringView line)
+{
+    for (QChar c : line) {
+        if (!c.isSpace()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int MarkdownLineScanner::referenceDefinitionLength(QStringView line)
+{
+    qsizetype i = 0;
+
+    while ((i < line.size()) && line[i].isSpace()) {
+        i++;
+    }
+
+    if ((i >= line.size()) || (QChar('[') != line[i])) {
+        return 0;
+    }
+
+    // The label holds at least two characters, and ends at the first
+    // "]:" that is not escaped with a backslash.
+    //
+    for (qsizetype close = i + 3; (close + 1) < line.size(); close++) {
+        if ((QChar(']') == line[close])
+                && (QChar(':') == line[close + 1])
+                && (QChar('\\') != line[close - 1])) {
+            return int(close + 2);
+        }
+    }
+
+    return 0;
+}
+
+bool MarkdownLineScanner::isInlineHtmlComment(QStringView line)
+{
+    static const QLatin1String open("<!--");
+    static const QLatin1String close("-->");
+
+    QStringView comment = line.trimmed();
+
+    return (comment.size() >= (open.size() + close.size()))
+        && comment.startsWith(open)
+        && comment.endsWith(close);
+}
+} // namespace ghostwriter
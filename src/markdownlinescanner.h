@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MARKDOWNLINESCANNER_H
+#define MARKDOWNLINESCANNER_H
+
+#include <QStringView>
+
+namespace ghostwriter
+{
+/**
+ * Recognizes the few kinds of lines that the MarkdownHighlighter has to
+ * find for itself, because the Markdown parser does not report them as
+ * nodes.  Scans the line in place, without allocating any memory, so that
+ * the highlighter can probe every line it highlights cheaply.
+ */
+class MarkdownLineScanner
+{
+public:
+    /**
+     * Returns true if the line is empty or consists only of whitespace.
+     */
+    static bool isBlank(QStringView line);
+
+    /**
+     * Returns the length of the label at the start of a reference link
+     * definition, up to and including the colon following it (i.e.,
+     * "  [label]:"), or 0 if the line does not start with one.
+     */
+    static int referenceDefinitionLength(QStringView line);
+
+    /**
+     * Returns true if the line consists only of an HTML comment, such as
+     * "<!-- comment -->", with optional surrounding whitespace.
+     */
+    static bool isInlineHtmlComment(QStringView line);
+
+private:
+    MarkdownLineScanner() = delete;
+};
+} // namespace ghostwriter
+
+#endif // MARKDOWNLINESCANNER_H
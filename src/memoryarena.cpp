@@ -59,6 +59,22 @@ void MemoryArena<T>::freeAll()
 
     slotIndex = 0;
 }
+
+template<class T>
+size_t MemoryArena<T>::allocatedCount() const
+{
+    if (arena.isEmpty()) {
+        return 0;
+    }
+
+    return ((arena.size() - 1) * chunkSize) + slotIndex;
+}
+
+template<class T>
+size_t MemoryArena<T>::reservedBytes() const
+{
+    return arena.size() * chunkSize * sizeof(T);
+}
 } // namespace ghostwriter
 
 #endif  // MEMORY_ARENA_CPP
@@ -49,6 +49,17 @@ public:
      */
     void freeAll();
 
+    /**
+     * Returns the number of objects allocated since the arena was last
+     * freed.
+     */
+    size_t allocatedCount() const;
+
+    /**
+     * Returns the number of bytes taken up by the arena's chunks.
+     */
+    size_t reservedBytes() const;
+
 private:
     typedef QVector<T> Chunk;
     QStack<Chunk *> arena;
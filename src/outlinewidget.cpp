@@ -11,6 +11,7 @@
 #include <QPointer>
 
 #include "outlinewidget.h"
+#include "tracer.h"
 
 namespace ghostwriter
 {
@@ -95,9 +96,9 @@ OutlineWidget::OutlineWidget(MarkdownEditor *editor, QWidget *parent)
 
     this->connect
     (
-        editor->document(),
-        &MarkdownDocument::contentsChange,
-        [d](int, int, int) {
+        (MarkdownDocument *) editor->document(),
+        &MarkdownDocument::contentsRevised,
+        [d]() {
             d->reloadOutline();
         }
     );
@@ -177,6 +178,8 @@ void OutlineWidgetPrivate::onOutlineHeadingSelected(QListWidgetItem *item)
 
 void OutlineWidgetPrivate::reloadOutline()
 {
+    TraceScope trace("OutlineWidget::reloadOutline");
+
     Q_Q(OutlineWidget);
 
     // Make sure editor and document haven't been deleted.
@@ -10,6 +10,7 @@
 #include <QDialogButtonBox>
 #include <QFormLayout>
 #include <QGroupBox>
+#include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QSpinBox>
@@ -20,6 +21,7 @@
 #include <Sonnet/ConfigWidget>
 
 #include "appsettings.h"
+#include "exportcache.h"
 #include "messageboxhelper.h"
 #include "preferencesdialog.h"
 
@@ -226,6 +228,14 @@ QWidget *PreferencesDialogPrivate::initializeGeneralTab()
     connect(backupCheckBox, SIGNAL(toggled(bool)), appSettings, SLOT(setBackupFileEnabled(bool)));
     savingGroupLayout->addRow(backupCheckBox);
 
+    QSpinBox *backupCountInput = new QSpinBox(q);
+    backupCountInput->setRange(1, AppSettings::MAX_BACKUP_FILE_COUNT);
+    backupCountInput->setValue(appSettings->backupFileCount());
+    backupCountInput->setEnabled(appSettings->backupFileEnabled());
+    connect(backupCountInput, SIGNAL(valueChanged(int)), appSettings, SLOT(setBackupFileCount(int)));
+    connect(backupCheckBox, SIGNAL(toggled(bool)), backupCountInput, SLOT(setEnabled(bool)));
+    savingGroupLayout->addRow(PreferencesDialog::tr("Backups to keep"), backupCountInput);
+
     QPushButton *openDraftDirButton = new QPushButton(PreferencesDialog::tr("View untitled drafts..."));
     q->connect(
         openDraftDirButton,
@@ -259,6 +269,46 @@ QWidget *PreferencesDialogPrivate::initializeGeneralTab()
     );
     sessionGroupLayout->addRow(restoreSessionCheckBox);
 
+    QGroupBox *exportGroupBox = new QGroupBox(PreferencesDialog::tr("Export"));
+    tabLayout->addWidget(exportGroupBox);
+
+    QFormLayout *exportGroupLayout = new QFormLayout();
+    exportGroupBox->setLayout(exportGroupLayout);
+
+    QCheckBox *exportCacheCheckBox = new QCheckBox(PreferencesDialog::tr("Reuse previous exports of unchanged documents"));
+    exportCacheCheckBox->setCheckable(true);
+    exportCacheCheckBox->setChecked(appSettings->exportCacheEnabled());
+    connect(exportCacheCheckBox, SIGNAL(toggled(bool)), appSettings, SLOT(setExportCacheEnabled(bool)));
+    exportGroupLayout->addRow(exportCacheCheckBox);
+
+    QSpinBox *exportCacheSizeInput = new QSpinBox(q);
+    exportCacheSizeInput->setRange(1, AppSettings::MAX_EXPORT_CACHE_SIZE);
+    exportCacheSizeInput->setSingleStep(64);
+    exportCacheSizeInput->setSuffix(PreferencesDialog::tr(" MB"));
+    exportCacheSizeInput->setValue(appSettings->exportCacheMaxSize());
+    exportCacheSizeInput->setEnabled(appSettings->exportCacheEnabled());
+    connect(exportCacheSizeInput, SIGNAL(valueChanged(int)), appSettings, SLOT(setExportCacheMaxSize(int)));
+    connect(exportCacheCheckBox, SIGNAL(toggled(bool)), exportCacheSizeInput, SLOT(setEnabled(bool)));
+    exportGroupLayout->addRow(PreferencesDialog::tr("Maximum cache size"), exportCacheSizeInput);
+
+    ExportCache *cache = ExportCache::instance();
+
+    QLabel *exportCacheStatsLabel = new QLabel(
+        PreferencesDialog::tr("%1 hits, %2 misses this session")
+            .arg(cache->hitCount())
+            .arg(cache->missCount()));
+    exportGroupLayout->addRow(PreferencesDialog::tr("Cache usage"), exportCacheStatsLabel);
+
+    QPushButton *clearExportCacheButton = new QPushButton(PreferencesDialog::tr("Clear cache"));
+    q->connect(
+        clearExportCacheButton,
+        &QPushButton::clicked,
+        [cache]() {
+            cache->clear();
+        }
+    );
+    exportGroupLayout->addRow(clearExportCacheButton);
+
     return tab;
 }
 
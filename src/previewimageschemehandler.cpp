@@ -0,0 +1,383 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QBuffer>
+#include <QCache>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QList>
+#include <QMimeDatabase>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QWebEngineUrlRequestJob>
+#include <QWebEngineUrlScheme>
+#include <QtConcurrentRun>
+
+#include "previewimageschemehandler.h"
+
+namespace ghostwriter
+{
+/*
+* Encoded image data and its MIME type, as served to the web engine.
+*/
+struct ScaledImage
+{
+    QByteArray data;
+    QByteArray mimeType;
+};
+
+class PreviewImageSchemeHandlerPrivate
+{
+    Q_DECLARE_PUBLIC(PreviewImageSchemeHandler)
+
+public:
+    /*
+    * Maximum total size of the scaled image cache, in kilobytes.
+    */
+    static const int MAX_CACHE_SIZE_KB = 64 * 1024;
+
+    PreviewImageSchemeHandlerPrivate(PreviewImageSchemeHandler *q_ptr)
+        : q_ptr(q_ptr)
+    {
+        ;
+    }
+
+    ~PreviewImageSchemeHandlerPrivate()
+    {
+        ;
+    }
+
+    PreviewImageSchemeHandler *q_ptr;
+
+    QThreadPool threadPool;
+    QCache<QString, ScaledImage> cache;
+
+    // Requests waiting on an image that is being scaled, by cache key,
+    // so that the same image is never scaled twice concurrently.
+    QHash<QString, QList<QPointer<QWebEngineUrlRequestJob>>> pendingJobs;
+
+    /*
+    * Returns the absolute path of the local raster image referenced by
+    * the given img source, or a null string if the source refers to a
+    * remote resource or to an unsupported image format.
+    */
+    static QString localImagePath(const QString &source, const QString &baseDir);
+
+    /*
+    * Reads the image at the given path, scaled down to the given width
+    * if it is wider.  Runs on the worker thread pool.
+    */
+    static ScaledImage scaleImage(const QString &path, int width);
+
+    void onImageScaled(const QString &key, const ScaledImage &image);
+    void reply(QWebEngineUrlRequestJob *job, const ScaledImage &image);
+};
+
+const QByteArray PreviewImageSchemeHandler::SCHEME = "ghostwriter-image";
+
+void PreviewImageSchemeHandler::registerScheme()
+{
+    QWebEngineUrlScheme scheme(SCHEME);
+    scheme.setSyntax(QWebEngineUrlScheme::Syntax::Path);
+    scheme.setFlags(QWebEngineUrlScheme::LocalScheme
+        | QWebEngineUrlScheme::LocalAccessAllowed);
+    QWebEngineUrlScheme::registerScheme(scheme);
+}
+
+QString PreviewImageSchemeHandler::rewriteImageSources
+(
+    const QString &html,
+    const QString &baseDir,
+    int width
+)
+{
+    static const QRegularExpression imageSourceExp(
+        "<img\\b[^>]*?\\ssrc\\s*=\\s*([\"'])(.*?)\\1",
+        QRegularExpression::CaseInsensitiveOption);
+
+    if (width <= 0) {
+        return html;
+    }
+
+    QString result;
+    int last = 0;
+
+    QRegularExpressionMatchIterator it = imageSourceExp.globalMatch(html);
+
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        QString path = PreviewImageSchemeHandlerPrivate::localImagePath(
+            match.captured(2), baseDir);
+
+        if (path.isNull()) {
+            continue;
+        }
+
+        QUrl url = QUrl::fromLocalFile(path);
+        url.setScheme(QString::fromLatin1(SCHEME));
+        url.setQuery(QString("width=%1").arg(width));
+
+        if (0 == last) {
+            result.reserve(html.length());
+        }
+
+        result += html.mid(last, match.capturedStart(2) - last);
+        result += url.toString(QUrl::FullyEncoded).toHtmlEscaped();
+        last = match.capturedEnd(2);
+    }
+
+    if (last <= 0) {
+        return html;
+    }
+
+    result += html.mid(last);
+    return result;
+}
+
+PreviewImageSchemeHandler::PreviewImageSchemeHandler(QObject *parent)
+    : QWebEngineUrlSchemeHandler(parent),
+      d_ptr(new PreviewImageSchemeHandlerPrivate(this))
+{
+    Q_D(PreviewImageSchemeHandler);
+
+    d->threadPool.setMaxThreadCount(2);
+    d->cache.setMaxCost(PreviewImageSchemeHandlerPrivate::MAX_CACHE_SIZE_KB);
+}
+
+PreviewImageSchemeHandler::~PreviewImageSchemeHandler()
+{
+    Q_D(PreviewImageSchemeHandler);
+
+    d->threadPool.waitForDone();
+}
+
+void PreviewImageSchemeHandler::requestStarted(QWebEngineUrlRequestJob *job)
+{
+    Q_D(PreviewImageSchemeHandler);
+
+    QUrl url = job->requestUrl();
+    int width = QUrlQuery(url).queryItemValue("width").toInt();
+
+    QUrl fileUrl;
+    fileUrl.setScheme("file");
+    fileUrl.setPath(url.path(QUrl::FullyDecoded));
+
+    QString path = fileUrl.toLocalFile();
+    QFileInfo fileInfo(path);
+
+    if ((width <= 0) || !fileInfo.isFile()) {
+        job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+        return;
+    }
+
+    // Include the modification time in the key so that an image edited
+    // while the document is open is scaled again.
+    //
+    QString key = QString("%1\n%2\n%3")
+        .arg(path)
+        .arg(fileInfo.lastModified().toMSecsSinceEpoch())
+        .arg(width);
+
+    ScaledImage *cachedImage = d->cache.object(key);
+
+    if (nullptr != cachedImage) {
+        d->reply(job, *cachedImage);
+        return;
+    }
+
+    if (d->pendingJobs.contains(key)) {
+        d->pendingJobs[key].append(job);
+        return;
+    }
+
+    d->pendingJobs.insert(key, { job });
+
+    QFutureWatcher<ScaledImage> *watcher = new QFutureWatcher<ScaledImage>(this);
+
+    this->connect(
+        watcher,
+        &QFutureWatcher<ScaledImage>::finished,
+        [d, watcher, key]() {
+            d->onImageScaled(key, watcher->result());
+            watcher->deleteLater();
+        }
+    );
+
+    watcher->setFuture(
+        QtConcurrent::run
+        (
+            &d->threadPool,
+            &PreviewImageSchemeHandlerPrivate::scaleImage,
+            path,
+            width
+        )
+    );
+}
+
+QString PreviewImageSchemeHandlerPrivate::localImagePath
+(
+    const QString &source,
+    const QString &baseDir
+)
+{
+    static const QStringList supportedSuffixes =
+        { "bmp", "jpeg", "jpg", "png", "webp" };
+
+    QString decodedSource = source;
+    decodedSource.replace("&amp;", "&");
+
+    QUrl url(decodedSource);
+    QString path;
+
+    // The Markdown processor percent-encodes spaces and non-ASCII
+    // characters in image sources, which must be decoded before the
+    // source can be used as a file path.
+    //
+    QString localPath = QUrl::fromPercentEncoding(decodedSource.toUtf8());
+
+    if (url.isLocalFile()) {
+        path = url.toLocalFile();
+    } else if (QDir::isAbsolutePath(localPath)) {
+        // Windows paths with drive letters are parsed as URL schemes,
+        // so check for absolute paths before treating the source as
+        // a remote URL.
+        //
+        path = localPath;
+    } else if (url.isRelative() && !decodedSource.startsWith("//")) {
+        path = url.path(QUrl::FullyDecoded);
+
+        if (QDir::isRelativePath(path)) {
+            if (baseDir.isEmpty()) {
+                return QString();
+            }
+
+            path = QDir(baseDir).filePath(path);
+        }
+    } else {
+        return QString();
+    }
+
+    if (!supportedSuffixes.contains(QFileInfo(path).suffix().toLower())) {
+        return QString();
+    }
+
+    return QDir::cleanPath(path);
+}
+
+ScaledImage PreviewImageSchemeHandlerPrivate::scaleImage
+(
+    const QString &path,
+    int width
+)
+{
+    ScaledImage image;
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    QSize size = reader.size();
+
+    if (!size.isValid() || size.isEmpty()) {
+        return image;
+    }
+
+    // The width at which the image is displayed is its height if its
+    // EXIF orientation rotates it.
+    //
+    QSize displaySize = size;
+
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+        displaySize.transpose();
+    }
+
+    // Serve images that are already small enough as they are.
+    if (displaySize.width() <= width) {
+        QFile file(path);
+
+        if (file.open(QFile::ReadOnly)) {
+            image.data = file.readAll();
+            image.mimeType =
+                QMimeDatabase().mimeTypeForFile(path).name().toLatin1();
+        }
+
+        return image;
+    }
+
+    // Have the reader scale while decoding, which for JPEG images avoids
+    // decoding the full resolution image at all.
+    //
+    qreal factor = ((qreal) width) / displaySize.width();
+    reader.setScaledSize(QSize(
+        qMax(1, qRound(size.width() * factor)),
+        qMax(1, qRound(size.height() * factor))));
+
+    QImage scaledImage = reader.read();
+
+    if (scaledImage.isNull()) {
+        return image;
+    }
+
+    QBuffer buffer(&image.data);
+    buffer.open(QBuffer::WriteOnly);
+
+    if (scaledImage.hasAlphaChannel()) {
+        scaledImage.save(&buffer, "PNG");
+        image.mimeType = "image/png";
+    } else {
+        scaledImage.save(&buffer, "JPEG", 90);
+        image.mimeType = "image/jpeg";
+    }
+
+    return image;
+}
+
+void PreviewImageSchemeHandlerPrivate::onImageScaled
+(
+    const QString &key,
+    const ScaledImage &image
+)
+{
+    QList<QPointer<QWebEngineUrlRequestJob>> jobs = pendingJobs.take(key);
+
+    for (QPointer<QWebEngineUrlRequestJob> job : jobs) {
+        // The job is destroyed if the request was cancelled.
+        if (job.isNull()) {
+            continue;
+        }
+
+        if (image.data.isEmpty()) {
+            job->fail(QWebEngineUrlRequestJob::RequestFailed);
+        } else {
+            reply(job, image);
+        }
+    }
+
+    if (!image.data.isEmpty()) {
+        cache.insert(key, new ScaledImage(image), (image.data.size() / 1024) + 1);
+    }
+}
+
+void PreviewImageSchemeHandlerPrivate::reply
+(
+    QWebEngineUrlRequestJob *job,
+    const ScaledImage &image
+)
+{
+    // Parent the buffer to the job so that it is deleted along with it.
+    QBuffer *buffer = new QBuffer(job);
+    buffer->setData(image.data);
+    buffer->open(QBuffer::ReadOnly);
+    job->reply(image.mimeType, buffer);
+}
+} // namespace ghostwriter
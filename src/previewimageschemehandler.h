@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef PREVIEWIMAGESCHEMEHANDLER_H
+#define PREVIEWIMAGESCHEMEHANDLER_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+#include <QWebEngineUrlSchemeHandler>
+
+namespace ghostwriter
+{
+/**
+ * Serves local images to the live HTML preview, downscaled to the width
+ * at which the preview can display them.  Scaled images are generated on
+ * a worker thread and cached in memory, keyed by file path, modification
+ * time and target width, so that the preview's web engine never has to
+ * decode a full resolution photo.
+ *
+ * Image URLs have the form ghostwriter-image:///absolute/path?width=N,
+ * which rewriteImageSources() substitutes into the preview's HTML.
+ * Export output is never rewritten.
+ */
+class PreviewImageSchemeHandlerPrivate;
+class PreviewImageSchemeHandler : public QWebEngineUrlSchemeHandler
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(PreviewImageSchemeHandler)
+
+public:
+    /**
+     * URL scheme served by this handler.
+     */
+    static const QByteArray SCHEME;
+
+    /**
+     * Registers the URL scheme with the web engine.  This must be called
+     * before the QApplication instance is created.
+     */
+    static void registerScheme();
+
+    /**
+     * Returns the given HTML with the sources of local raster images
+     * rewritten to be served by this handler, scaled to the given width
+     * in pixels.  Relative image paths are resolved against baseDir.
+     * This method is thread-safe.
+     */
+    static QString rewriteImageSources
+    (
+        const QString &html,
+        const QString &baseDir,
+        int width
+    );
+
+    /**
+     * Constructor.
+     */
+    PreviewImageSchemeHandler(QObject *parent = nullptr);
+
+    /**
+     * Destructor.
+     */
+    virtual ~PreviewImageSchemeHandler();
+
+    /**
+     * Serves the scaled image for the request, from the cache if
+     * available or else once the worker thread has generated it.
+     */
+    void requestStarted(QWebEngineUrlRequestJob *job) override;
+
+private:
+    QScopedPointer<PreviewImageSchemeHandlerPrivate> d_ptr;
+};
+} // namespace ghostwriter
+
+#endif // PREVIEWIMAGESCHEMEHANDLER_H
@@ -11,6 +11,7 @@
 #include <QPushButton>
 #include <QFileInfo>
 #include <QLineEdit>
+#include <QSpinBox>
 
 #include "previewoptionsdialog.h"
 #include "appsettings.h"
@@ -139,6 +140,15 @@ PreviewOptionsDialog::PreviewOptionsDialog(QWidget *parent)
 
     optionsLayout->addRow(tr("Code Font:"), fontLayout);
 
+    QSpinBox *unloadDelayInput = new QSpinBox(this);
+    unloadDelayInput->setRange(0, AppSettings::MAX_HTML_PREVIEW_UNLOAD_DELAY);
+    unloadDelayInput->setSingleStep(30);
+    unloadDelayInput->setSuffix(tr(" s"));
+    unloadDelayInput->setSpecialValueText(tr("Never"));
+    unloadDelayInput->setValue(d->appSettings->htmlPreviewUnloadDelay());
+    connect(unloadDelayInput, SIGNAL(valueChanged(int)), d->appSettings, SLOT(setHtmlPreviewUnloadDelay(int)));
+    optionsLayout->addRow(tr("Unload When Hidden After:"), unloadDelayInput);
+
     QDialogButtonBox *buttonBox = new QDialogButtonBox(Qt::Horizontal, this);
     buttonBox->addButton(QDialogButtonBox::Close);
     layout->addWidget(buttonBox);
@@ -12,7 +12,8 @@ PreviewProxy::PreviewProxy(QObject *parent)
     : QObject(parent),
       m_htmlContent(""),
       m_styleSheet(""),
-      m_mathEnabled(false)
+      m_mathEnabled(false),
+      m_mathCacheHits(0)
 {
     ;
 }
@@ -56,4 +57,17 @@ bool PreviewProxy::mathEnabled() const
 {
     return m_mathEnabled;
 }
+
+void PreviewProxy::setMathCacheHits(int hits)
+{
+    if (hits != m_mathCacheHits) {
+        m_mathCacheHits = hits;
+        emit mathCacheHitsChanged(m_mathCacheHits);
+    }
+}
+
+int PreviewProxy::mathCacheHits() const
+{
+    return m_mathCacheHits;
+}
 } // namespace ghostwriter
@@ -65,6 +65,20 @@ public:
     Q_INVOKABLE bool mathEnabled() const;
     Q_PROPERTY(bool mathEnabled READ mathEnabled NOTIFY mathToggled)
 
+    /**
+     * Called by the live preview to report the running count of
+     * equations whose rendering was reused from its math cache rather
+     * than typeset again.
+     */
+    Q_INVOKABLE void setMathCacheHits(int hits);
+
+    /**
+     * Returns the number of equations whose cached rendering was reused
+     * by the live preview.
+     */
+    Q_INVOKABLE int mathCacheHits() const;
+    Q_PROPERTY(int mathCacheHits READ mathCacheHits NOTIFY mathCacheHitsChanged)
+
 signals:
     /**
      * Emitted when the HTML content changes.
@@ -81,10 +95,16 @@ signals:
      */
     void mathToggled(bool enabled);
 
+    /**
+     * Emitted when the live preview reports a new math cache hit count.
+     */
+    void mathCacheHitsChanged(int hits);
+
 private:
     QString m_htmlContent;
     QString m_styleSheet;
     bool m_mathEnabled;
+    int m_mathCacheHits;
 };
 
 } // namespace ghostwriter
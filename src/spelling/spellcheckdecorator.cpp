@@ -26,6 +26,9 @@
 #include <Sonnet/Settings>
 #include <Sonnet/Speller>
 
+#include "../markdowndocument.h"
+#include "../tracer.h"
+
 #include "spellcheckdecorator.h"
 #include "spellcheckdialog.h"
 
@@ -395,10 +398,23 @@ void SpellCheckDecoratorPrivate::onContentsChanged(
     int charsAdded,
     int charsRemoved)
 {
+    TraceScope trace("SpellCheckDecorator::onContentsChanged");
+
     if (!this->settings->checkerEnabledByDefault()) {
         return;
     }
 
+    // Wait until a document that is being loaded in chunks is complete.
+    // The syntax highlighter then rehighlights it, which brings each
+    // block through here again.
+    //
+    MarkdownDocument *document =
+        qobject_cast<MarkdownDocument *>(editor->document());
+
+    if ((nullptr != document) && document->isLoading()) {
+        return;
+    }
+
     QTextBlock firstBlock = editor->document()->findBlock(position);
     QTextBlock lastBlock = editor->document()->findBlock(position
                             + charsAdded + charsRemoved);
@@ -33,6 +33,8 @@ public:
         alphaNumericCharacterCount = 0;
         sentenceCount = 0;
         lixLongWordCount = 0;
+        lineBreak = false;
+        rightToLeft = false;
     }
 
     /**
@@ -50,6 +52,19 @@ public:
     int sentenceCount;
     int lixLongWordCount;
 
+    /**
+     * True if the block ends with two spaces, which mark a Markdown line
+     * break.  Kept up to date by the MarkdownHighlighter.
+     */
+    bool lineBreak;
+
+    /**
+     * True if the block's text is right-to-left, so that the editor can
+     * lay it out as such without scanning the text on every paint.  Kept
+     * up to date by the MarkdownHighlighter.
+     */
+    bool rightToLeft;
+
     /**
      * Parent text block.  For use with fetching the block's document
      * position, which can shift as text is inserted and deleted.
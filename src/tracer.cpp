@@ -0,0 +1,246 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <memory>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include "tracer.h"
+
+namespace ghostwriter
+{
+/*
+* An event recorded by a TraceScope.
+*/
+struct TraceEvent
+{
+    const char *name;
+    qint64 startTime;
+    qint64 endTime;
+};
+
+/*
+* Ring buffer of the most recent events recorded by a thread.  Only the
+* thread itself writes to it, so no locking is needed.  The event count is
+* published with release semantics so that writeTrace() sees the events
+* written before it.
+*/
+struct TraceBuffer
+{
+    // Must be a power of two.
+    static const quint64 CAPACITY = 64 * 1024;
+
+    TraceBuffer(int threadId, const QString &threadName)
+        : threadId(threadId),
+          threadName(threadName),
+          count(0),
+          events(new TraceEvent[CAPACITY])
+    {
+        ;
+    }
+
+    int threadId;
+    QString threadName;
+    std::atomic<quint64> count;
+    std::unique_ptr<TraceEvent[]> events;
+};
+
+class TracerPrivate
+{
+public:
+    static QString filePath;
+    static QElapsedTimer clock;
+    static std::atomic<bool> monitoring;
+
+    // True while events are kept for the trace file.  Only the main
+    // thread touches filePath, but any thread may check this.
+    //
+    static std::atomic<bool> recording;
+
+    // Guards the list of buffers, which is only changed the first time
+    // each thread records an event.
+    //
+    static QMutex buffersMutex;
+    static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+    static thread_local TraceBuffer *threadBuffer;
+
+    /*
+    * Returns the calling thread's buffer, creating it if necessary.
+    */
+    static TraceBuffer *currentBuffer();
+};
+
+const char *Tracer::ENVIRONMENT_VARIABLE = "GHOSTWRITER_TRACE";
+std::atomic<bool> Tracer::enabled(false);
+
+QString TracerPrivate::filePath;
+QElapsedTimer TracerPrivate::clock;
+std::atomic<bool> TracerPrivate::monitoring(false);
+std::atomic<bool> TracerPrivate::recording(false);
+QMutex TracerPrivate::buffersMutex;
+std::vector<std::unique_ptr<TraceBuffer>> TracerPrivate::buffers;
+thread_local TraceBuffer *TracerPrivate::threadBuffer = nullptr;
+
+void Tracer::start(const QString &filePath)
+{
+    TracerPrivate::filePath = filePath;
+
+    if (!TracerPrivate::clock.isValid()) {
+        TracerPrivate::clock.start();
+    }
+
+    TracerPrivate::recording.store(true, std::memory_order_release);
+    enabled.store(true, std::memory_order_release);
+}
+
+void Tracer::startMonitoring()
+{
+    // Create the monitor before any thread can record into it.
+    LatencyMonitor::instance();
+
+    if (!TracerPrivate::clock.isValid()) {
+        TracerPrivate::clock.start();
+    }
+
+    TracerPrivate::monitoring.store(true, std::memory_order_release);
+    enabled.store(true, std::memory_order_release);
+}
+
+bool Tracer::isMonitoring()
+{
+    return TracerPrivate::monitoring.load(std::memory_order_relaxed);
+}
+
+qint64 Tracer::timestamp()
+{
+    return TracerPrivate::clock.nsecsElapsed();
+}
+
+void Tracer::record
+(
+    const char *name,
+    LatencyMetric metric,
+    qint64 startTime,
+    qint64 endTime
+)
+{
+    if ((LatencyMetricNone != metric) && isMonitoring()) {
+        LatencyMonitor::instance()->record(metric, startTime, endTime);
+    }
+
+    // Only keep events around if there is a trace to write them to.
+    if (!TracerPrivate::recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    TraceBuffer *buffer = TracerPrivate::currentBuffer();
+    quint64 count = buffer->count.load(std::memory_order_relaxed);
+
+    TraceEvent &event = buffer->events[count & (TraceBuffer::CAPACITY - 1)];
+    event.name = name;
+    event.startTime = startTime;
+    event.endTime = endTime;
+
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+bool Tracer::writeTrace(QString &err)
+{
+    if (!TracerPrivate::recording.load(std::memory_order_acquire)) {
+        return true;
+    }
+
+    // Latency monitoring doesn't need the event buffers.
+    TracerPrivate::recording.store(false, std::memory_order_release);
+    enabled.store(isMonitoring(), std::memory_order_release);
+
+    QJsonArray traceEvents;
+    qint64 pid = QCoreApplication::applicationPid();
+
+    QMutexLocker locker(&TracerPrivate::buffersMutex);
+
+    for (const std::unique_ptr<TraceBuffer> &buffer : TracerPrivate::buffers) {
+        QJsonObject threadName;
+        threadName.insert("name", "thread_name");
+        threadName.insert("ph", "M");
+        threadName.insert("pid", pid);
+        threadName.insert("tid", buffer->threadId);
+        threadName.insert("args", QJsonObject({{ "name", buffer->threadName }}));
+        traceEvents.append(threadName);
+
+        quint64 count = buffer->count.load(std::memory_order_acquire);
+        quint64 first = 0;
+
+        // Older events were overwritten by newer ones.
+        if (count > TraceBuffer::CAPACITY) {
+            first = count - TraceBuffer::CAPACITY;
+        }
+
+        for (quint64 i = first; i < count; i++) {
+            const TraceEvent &event = buffer->events[i & (TraceBuffer::CAPACITY - 1)];
+
+            // Complete events, with times in microseconds.
+            QJsonObject traceEvent;
+            traceEvent.insert("name", QString::fromLatin1(event.name));
+            traceEvent.insert("ph", "X");
+            traceEvent.insert("ts", event.startTime / 1000.0);
+            traceEvent.insert("dur", (event.endTime - event.startTime) / 1000.0);
+            traceEvent.insert("pid", pid);
+            traceEvent.insert("tid", buffer->threadId);
+            traceEvents.append(traceEvent);
+        }
+    }
+
+    locker.unlock();
+
+    QJsonObject trace;
+    trace.insert("traceEvents", traceEvents);
+    trace.insert("displayTimeUnit", "ms");
+
+    QSaveFile file(TracerPrivate::filePath);
+
+    if (!file.open(QIODevice::WriteOnly)
+            || (file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) < 0)
+            || !file.commit()) {
+        err = file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+TraceBuffer *TracerPrivate::currentBuffer()
+{
+    if (nullptr == threadBuffer) {
+        QThread *thread = QThread::currentThread();
+        QString name = thread->objectName();
+
+        if ((nullptr != QCoreApplication::instance())
+                && (thread == QCoreApplication::instance()->thread())) {
+            name = "main";
+        } else if (name.isEmpty()) {
+            name = QString("thread %1").arg(quintptr(QThread::currentThreadId()));
+        }
+
+        QMutexLocker locker(&buffersMutex);
+
+        buffers.emplace_back(new TraceBuffer(int(buffers.size()) + 1, name));
+        threadBuffer = buffers.back().get();
+    }
+
+    return threadBuffer;
+}
+} // namespace ghostwriter
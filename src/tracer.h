@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Megan Conkle <megan.conkle@kdemail.net>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "latencymonitor.h"
+
+namespace ghostwriter
+{
+/**
+ * Records how long the stages between a key press and the repaint of the
+ * editor take, for finding where typing latency comes from.  Tracing is
+ * enabled by passing --trace <file> on the command line, or by setting
+ * the GHOSTWRITER_TRACE environment variable to the file path.  The trace
+ * is written to the file on exit in the Chrome trace event JSON format,
+ * which can be viewed in Perfetto (https://ui.perfetto.dev) or in
+ * chrome://tracing.
+ *
+ * Each thread records into its own ring buffer, which keeps the most
+ * recent events, without taking any locks.  When tracing is disabled,
+ * a TraceScope costs a single relaxed atomic load.
+ *
+ * Scopes can also feed a LatencyMonitor metric, for the live latency
+ * HUD, which is enabled separately with startMonitoring().
+ */
+class Tracer
+{
+public:
+    /**
+     * Name of the environment variable holding the path of the file to
+     * write the trace to.
+     */
+    static const char *ENVIRONMENT_VARIABLE;
+
+    /**
+     * Returns true if tracing or latency monitoring is enabled.
+     */
+    static inline bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Enables tracing.  The trace is written to the given file when
+     * writeTrace() is called.
+     */
+    static void start(const QString &filePath);
+
+    /**
+     * Enables feeding the LatencyMonitor from the trace scopes that have
+     * a metric, whether or not a trace file is being written.
+     */
+    static void startMonitoring();
+
+    /**
+     * Returns true if latency monitoring is enabled.
+     */
+    static bool isMonitoring();
+
+    /**
+     * Returns the current time, in nanoseconds since tracing started.
+     */
+    static qint64 timestamp();
+
+    /**
+     * Records an event with the given name, which must be a string
+     * literal, for the current thread, and adds its duration to the given
+     * LatencyMonitor metric, if any.
+     */
+    static void record
+    (
+        const char *name,
+        LatencyMetric metric,
+        qint64 startTime,
+        qint64 endTime
+    );
+
+    /**
+     * Stops tracing and writes the events recorded so far to the file
+     * given to start(), if any.  Must be called once the other threads are
+     * no longer recording.  Returns false and sets err if the file could
+     * not be written.
+     */
+    static bool writeTrace(QString &err);
+
+private:
+    static std::atomic<bool> enabled;
+
+    Tracer() = delete;
+};
+
+/**
+ * Records the time from its construction to its destruction as a trace
+ * event, if tracing is enabled.  Declare one at the top of the function
+ * or block to measure, e.g.:
+ *
+ *     TraceScope trace("MarkdownEditor::keyPressEvent");
+ *
+ * Pass a metric to also add the time to the LatencyMonitor.
+ */
+class TraceScope
+{
+public:
+    /**
+     * Constructor.  The name must be a string literal.
+     */
+    explicit inline TraceScope
+    (
+        const char *name,
+        LatencyMetric metric = LatencyMetricNone
+    )
+        : name(name),
+          metric(metric),
+          startTime(Tracer::isEnabled() ? Tracer::timestamp() : -1)
+    {
+        ;
+    }
+
+    /**
+     * Destructor.  Records the event.
+     */
+    inline ~TraceScope()
+    {
+        if (startTime >= 0) {
+            Tracer::record(name, metric, startTime, Tracer::timestamp());
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+
+    const char *name;
+    LatencyMetric metric;
+    qint64 startTime;
+};
+} // namespace ghostwriter
+
+#endif // TRACER_H